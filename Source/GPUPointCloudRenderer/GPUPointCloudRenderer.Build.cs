@@ -12,10 +12,10 @@ namespace UnrealBuildTool.Rules
             get { return ModuleDirectory; }
         }
 
-        //private string ThirdPartyPath
-        //{
-        //    get { return Path.GetFullPath(Path.Combine(ModulePath, "../ThirdParty/")); }
-        //}
+        private string ThirdPartyPath
+        {
+            get { return Path.GetFullPath(Path.Combine(ModulePath, "../ThirdParty/")); }
+        }
 
         //private string BinariesPath
         //{
@@ -26,9 +26,10 @@ namespace UnrealBuildTool.Rules
         {
             PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private"));
             PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public"));
+            PrivateIncludePaths.Add(Path.Combine(ThirdPartyPath, "PointCloudSharedMemory", "include"));
 
             PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "RHI", "CustomMeshComponent" });
-            PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects", "CustomMeshComponent" });
+            PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects", "CustomMeshComponent", "RenderCore" });
 
         }
     }
@@ -26,6 +26,31 @@ class FGPUPointCloudRendererPlugin : public IGPUPointCloudRenderer
 	FPointCloudStreamingCore* CreateStreamingInstance(UMaterialInstanceDynamic* pointCloudShaderDynInstance) {
 		return new FPointCloudStreamingCore(pointCloudShaderDynInstance);
 	}
+
+	/**
+	* Returns the shared instance of the Point Cloud Core class with the given name.
+	*/
+	TSharedPtr<FPointCloudStreamingCore> GetSharedStreamingInstance(FName dataName) {
+
+		// Only weak references are kept, so a shared core is freed as soon as no component uses it anymore
+		TWeakPtr<FPointCloudStreamingCore> &entry = mSharedInstances.FindOrAdd(dataName);
+		TSharedPtr<FPointCloudStreamingCore> instance = entry.Pin();
+		if (!instance.IsValid()) {
+			instance = MakeShareable(new FPointCloudStreamingCore());
+			entry = instance;
+		}
+
+		// Drop the entries of freed cores
+		for (auto it = mSharedInstances.CreateIterator(); it; ++it) {
+			if (!it.Value().IsValid())
+				it.RemoveCurrent();
+		}
+
+		return instance;
+	}
+
+private:
+	TMap<FName, TWeakPtr<FPointCloudStreamingCore>> mSharedInstances;
 };
 
 IMPLEMENT_MODULE(FGPUPointCloudRendererPlugin, GPUPointCloudRenderer)
@@ -0,0 +1,391 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudArchive.h"
+#include "PointCloudStreamingCore.h"
+#include "PointCloudSpatialSort.h"
+#include "PointCloudLayout.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/Compression.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+
+DECLARE_CYCLE_STAT(TEXT("Write Point Cloud Archive"), STAT_WritePointCloudArchive, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Read Point Cloud Archive"), STAT_ReadPointCloudArchive, STATGROUP_GPUPCR);
+
+namespace PointCloudArchive
+{
+	const uint32 FileMagic = 0x41524350;	// "PCRA"
+	const uint32 FileVersion = 1;
+	const int32 MaxVarintBytes = 10;
+
+	FORCEINLINE uint8* WriteVarint(uint8* out, uint64 value)
+	{
+		while (value >= 0x80) {
+			*out++ = (uint8)(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = (uint8)value;
+		return out;
+	}
+
+	FORCEINLINE const uint8* ReadVarint(const uint8* in, const uint8* end, uint64 &outValue)
+	{
+		outValue = 0;
+		for (uint32 shift = 0; in < end && shift < 64; shift += 7) {
+			const uint8 byte = *in++;
+			outValue |= (uint64)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return in;
+		}
+		return nullptr;
+	}
+
+	/** Compresses the given stream with zlib, keeps it raw if that does not pay off. Returns the stored size. */
+	int32 CompressStream(const TArray<uint8> &stream, TArray<uint8> &outData)
+	{
+		int32 compressedSize = FCompression::CompressMemoryBound(NAME_Zlib, stream.Num());
+		outData.SetNumUninitialized(compressedSize, false);
+		if (!FCompression::CompressMemory(NAME_Zlib, outData.GetData(), compressedSize, stream.GetData(), stream.Num()) || compressedSize >= stream.Num()) {
+			outData = stream;
+			return stream.Num();
+		}
+		outData.SetNum(compressedSize, false);
+		return compressedSize;
+	}
+
+	bool UncompressStream(const uint8* data, int32 storedSize, int32 rawSize, TArray<uint8> &outStream)
+	{
+		outStream.SetNumUninitialized(rawSize, false);
+		if (storedSize == rawSize) {
+			FMemory::Memcpy(outStream.GetData(), data, rawSize);
+			return true;
+		}
+		return FCompression::UncompressMemory(NAME_Zlib, outStream.GetData(), rawSize, data, storedSize);
+	}
+}
+
+using namespace PointCloudArchive;
+
+FString FPointCloudArchiveStats::ToString() const
+{
+	const double rawMB = RawBytes / (1024.0 * 1024.0);
+	return FString::Printf(TEXT("%d points, %.1f MB raw, %.1f MB on disk (%.2fx), I/O %.1f ms, codec %.1f ms (%.0f MB/s raw)"),
+		PointCount, rawMB, FileBytes / (1024.0 * 1024.0), GetCompressionRatio(), IOSeconds * 1000.0, CodecSeconds * 1000.0, CodecSeconds > 0.0 ? rawMB / CodecSeconds : 0.0);
+}
+
+//////////////////////
+// WRITING ///////////
+//////////////////////
+
+bool FPointCloudArchive::Write(const FString &filePath, const FLinearColor* pointPositions, const uint8* pointColors, int32 pointCount, float precision, FPointCloudArchiveStats* outStats)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WritePointCloudArchive);
+
+	if (!pointPositions || !pointColors || pointCount <= 0)
+		return false;
+
+	const double startTime = FPlatformTime::Seconds();
+
+	// Bounds
+	const int32 chunkCount = FMath::DivideAndRoundUp(pointCount, ChunkPointCount);
+	TArray<FBox> chunkBounds;
+	chunkBounds.Init(FBox(ForceInit), chunkCount);
+	ParallelFor(chunkCount, [&](int32 chunk) {
+		const int32 end = FMath::Min((chunk + 1) * ChunkPointCount, pointCount);
+		for (int32 i = chunk * ChunkPointCount; i < end; ++i)
+			chunkBounds[chunk] += PointCloudLayout::UnpackPosition(pointPositions[i]);
+	});
+	FBox bounds(ForceInit);
+	for (const FBox &box : chunkBounds)
+		bounds += box;
+
+	// Quantization grid, 21 bits per axis
+	const float maxStep = bounds.GetSize().GetMax() / PointCloudSpatialSort::MaxAxisValue;
+	const float step = FMath::Max3(precision, maxStep, SMALL_NUMBER);
+	const float invStep = 1.f / step;
+
+	FFileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.PointCount = pointCount;
+	header.ChunkCount = chunkCount;
+	header.Step = step;
+	for (int32 axis = 0; axis < 3; ++axis) {
+		header.Origin[axis] = bounds.Min[axis];
+		header.MaxKey[axis] = (uint32)FMath::Min(FMath::CeilToInt(bounds.GetSize()[axis] * invStep), (int32)PointCloudSpatialSort::MaxAxisValue);
+	}
+
+	// Global Morton order, so every chunk is spatially compact
+	FPointCloudSpatialSorter sorter;
+	sorter.Sort(pointPositions, pointCount, bounds, EPointCloudSortOrder::Morton);
+	const TArray<int32> &permutation = sorter.GetPermutation();
+
+	TArray<FChunkEntry> entries;
+	entries.SetNumZeroed(chunkCount);
+	TArray<TArray<uint8>> payloads;
+	payloads.SetNum(chunkCount);
+
+	ParallelFor(chunkCount, [&](int32 chunk) {
+
+		const int32 first = chunk * ChunkPointCount;
+		const int32 count = FMath::Min(ChunkPointCount, pointCount - first);
+
+		// Exact keys on the quantization grid. The global order is based on the normalized bounds, so sort once more to get monotone keys
+		TArray<uint64> keys;
+		TArray<int32> order;
+		keys.SetNumUninitialized(count);
+		order.SetNumUninitialized(count);
+		for (int32 i = 0; i < count; ++i) {
+			const FVector position = PointCloudLayout::UnpackPosition(pointPositions[permutation[first + i]]);
+			uint32 quantized[3];
+			for (int32 axis = 0; axis < 3; ++axis)
+				quantized[axis] = (uint32)FMath::Clamp(FMath::RoundToInt((position[axis] - header.Origin[axis]) * invStep), 0, (int32)header.MaxKey[axis]);
+			keys[i] = PointCloudSpatialSort::EncodeMorton(quantized[0], quantized[1], quantized[2]);
+			order[i] = i;
+		}
+		order.Sort([&keys](const int32 &a, const int32 &b) { return keys[a] < keys[b]; });
+
+		// Position stream: delta-coded keys
+		TArray<uint8> positionStream;
+		positionStream.SetNumUninitialized(count * MaxVarintBytes);
+		uint8* out = positionStream.GetData();
+		uint64 previousKey = 0;
+		for (int32 i = 0; i < count; ++i) {
+			const uint64 key = keys[order[i]];
+			out = WriteVarint(out, key - previousKey);
+			previousKey = key;
+		}
+		positionStream.SetNum(out - positionStream.GetData(), false);
+
+		// Color stream: one delta-coded plane per channel
+		TArray<uint8> colorStream;
+		colorStream.SetNumUninitialized(count * 4);
+		for (int32 channel = 0; channel < 4; ++channel) {
+			uint8* plane = colorStream.GetData() + channel * count;
+			uint8 previous = 0;
+			for (int32 i = 0; i < count; ++i) {
+				const uint8 value = pointColors[permutation[first + order[i]] * 4 + channel];
+				plane[i] = value - previous;
+				previous = value;
+			}
+		}
+
+		TArray<uint8> positionData;
+		TArray<uint8> colorData;
+		FChunkEntry &entry = entries[chunk];
+		entry.PointCount = count;
+		entry.PositionSize = positionStream.Num();
+		entry.PositionCompressedSize = CompressStream(positionStream, positionData);
+		entry.ColorCompressedSize = CompressStream(colorStream, colorData);
+
+		TArray<uint8> &payload = payloads[chunk];
+		payload.SetNumUninitialized(entry.PositionCompressedSize + entry.ColorCompressedSize);
+		FMemory::Memcpy(payload.GetData(), positionData.GetData(), entry.PositionCompressedSize);
+		FMemory::Memcpy(payload.GetData() + entry.PositionCompressedSize, colorData.GetData(), entry.ColorCompressedSize);
+	});
+
+	int64 offset = 0;
+	for (int32 chunk = 0; chunk < chunkCount; ++chunk) {
+		entries[chunk].Offset = offset;
+		offset += payloads[chunk].Num();
+	}
+
+	const double encodedTime = FPlatformTime::Seconds();
+
+	FArchive* writer = IFileManager::Get().CreateFileWriter(*filePath);
+	if (!writer)
+		return false;
+
+	writer->Serialize(&header, sizeof(FFileHeader));
+	writer->Serialize(entries.GetData(), entries.Num() * sizeof(FChunkEntry));
+	for (TArray<uint8> &payload : payloads)
+		writer->Serialize(payload.GetData(), payload.Num());
+
+	const bool success = !writer->IsError();
+	const int64 fileSize = writer->TotalSize();
+	writer->Close();
+	delete writer;
+
+	if (outStats) {
+		outStats->PointCount = pointCount;
+		outStats->RawBytes = (int64)pointCount * (sizeof(FLinearColor) + 4);
+		outStats->FileBytes = fileSize;
+		outStats->CodecSeconds = encodedTime - startTime;
+		outStats->IOSeconds = FPlatformTime::Seconds() - encodedTime;
+	}
+
+	return success;
+}
+
+//////////////////////
+// READING ///////////
+//////////////////////
+
+bool FPointCloudArchive::Open(const FString &filePath)
+{
+	Close();
+
+	mReader = IFileManager::Get().CreateFileReader(*filePath);
+	if (!mReader)
+		return false;
+
+	mReader->Serialize(&mHeader, sizeof(FFileHeader));
+	if (mReader->IsError() || mHeader.Magic != FileMagic || mHeader.Version != FileVersion || mHeader.PointCount <= 0 || mHeader.ChunkCount != FMath::DivideAndRoundUp(mHeader.PointCount, ChunkPointCount)) {
+		Close();
+		return false;
+	}
+
+	mChunks.SetNumUninitialized(mHeader.ChunkCount);
+	mReader->Serialize(mChunks.GetData(), mChunks.Num() * sizeof(FChunkEntry));
+	if (mReader->IsError()) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FPointCloudArchive::Close()
+{
+	if (mReader) delete mReader; mReader = nullptr;
+	mHeader = FFileHeader();
+	mChunks.Empty();
+	mReadBuffers[0].Empty();
+	mReadBuffers[1].Empty();
+}
+
+FBox FPointCloudArchive::GetBounds() const
+{
+	const FVector origin(mHeader.Origin[0], mHeader.Origin[1], mHeader.Origin[2]);
+	return FBox(origin, origin + FVector(mHeader.MaxKey[0], mHeader.MaxKey[1], mHeader.MaxKey[2]) * mHeader.Step);
+}
+
+bool FPointCloudArchive::Read(FLinearColor* outPositions, uint8* outColors, FPointCloudArchiveStats* outStats)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ReadPointCloudArchive);
+
+	if (!mReader || !outPositions || !outColors)
+		return false;
+
+	const double startTime = FPlatformTime::Seconds();
+
+	// The chunks have to be stored in order and must not overlap, so consecutive chunks can be read in one go.
+	// The sizes are bounded by what Write() can produce, so a corrupt table cannot cause huge allocations in the decode tasks
+	const int64 payloadStart = mReader->Tell();
+	const int64 payloadSize = mReader->TotalSize() - payloadStart;
+	int64 previousEnd = 0;
+	for (int32 chunk = 0; chunk < mChunks.Num(); ++chunk) {
+		const FChunkEntry &entry = mChunks[chunk];
+		const int32 count = entry.PointCount;
+		if (count != FMath::Min(ChunkPointCount, mHeader.PointCount - chunk * ChunkPointCount))
+			return false;
+		if (entry.PositionSize < 0 || entry.PositionSize > count * MaxVarintBytes
+			|| entry.PositionCompressedSize < 0 || entry.PositionCompressedSize > entry.PositionSize
+			|| entry.ColorCompressedSize < 0 || entry.ColorCompressedSize > count * 4)
+			return false;
+		if (entry.Offset < previousEnd || entry.Offset + entry.PositionCompressedSize + entry.ColorCompressedSize > payloadSize)
+			return false;
+		previousEnd = entry.Offset + entry.PositionCompressedSize + entry.ColorCompressedSize;
+	}
+
+	const FVector origin(mHeader.Origin[0], mHeader.Origin[1], mHeader.Origin[2]);
+	const float step = mHeader.Step;
+	FThreadSafeCounter failedChunks;
+
+	auto decodeChunk = [&](int32 chunk, const uint8* data) {
+
+		const FChunkEntry &entry = mChunks[chunk];
+		const int32 first = chunk * ChunkPointCount;
+		const int32 count = entry.PointCount;
+		TArray<uint8> positionStream;
+		TArray<uint8> colorStream;
+		if (!UncompressStream(data, entry.PositionCompressedSize, entry.PositionSize, positionStream)
+			|| !UncompressStream(data + entry.PositionCompressedSize, entry.ColorCompressedSize, count * 4, colorStream)) {
+			failedChunks.Increment();
+			return;
+		}
+
+		// Positions
+		const uint8* in = positionStream.GetData();
+		const uint8* end = in + positionStream.Num();
+		uint64 key = 0;
+		for (int32 i = 0; i < count; ++i) {
+			uint64 delta;
+			in = ReadVarint(in, end, delta);
+			if (!in) {
+				failedChunks.Increment();
+				return;
+			}
+			key += delta;
+
+			uint32 x, y, z;
+			PointCloudSpatialSort::DecodeMorton(key, x, y, z);
+			PointCloudLayout::PackPosition(origin + FVector(x, y, z) * step, outPositions[first + i]);
+		}
+
+		// Colors
+		for (int32 channel = 0; channel < 4; ++channel) {
+			const uint8* plane = colorStream.GetData() + channel * count;
+			uint8* colors = outColors + first * 4 + channel;
+			uint8 value = 0;
+			for (int32 i = 0; i < count; ++i) {
+				value += plane[i];
+				colors[i * 4] = value;
+			}
+		}
+	};
+
+	// Every batch is decoded on the thread pool (in parallel over its chunks) while the next batch is read into the other buffer
+	TFuture<void> decodeTask;
+	double ioSeconds = 0.0;
+	bool readFailed = false;
+	for (int32 firstChunk = 0, batch = 0; firstChunk < mChunks.Num(); ++batch) {
+
+		const int64 batchStart = mChunks[firstChunk].Offset;
+		int64 batchEnd = batchStart;
+		int32 endChunk = firstChunk;
+		while (endChunk < mChunks.Num() && (endChunk == firstChunk || batchEnd - batchStart < ReadBatchBytes)) {
+			const FChunkEntry &entry = mChunks[endChunk++];
+			batchEnd = entry.Offset + entry.PositionCompressedSize + entry.ColorCompressedSize;
+		}
+
+		// The batch before the previous one used this buffer, it was decoded before the previous batch was started
+		TArray<uint8> &buffer = mReadBuffers[batch % 2];
+		const double readStart = FPlatformTime::Seconds();
+		buffer.SetNumUninitialized((int32)(batchEnd - batchStart), false);
+		mReader->Seek(payloadStart + batchStart);
+		mReader->Serialize(buffer.GetData(), buffer.Num());
+		ioSeconds += FPlatformTime::Seconds() - readStart;
+		if (mReader->IsError()) {
+			readFailed = true;
+			break;
+		}
+
+		if (decodeTask.IsValid())
+			decodeTask.Wait();
+		decodeTask = Async(EAsyncExecution::ThreadPool, [this, &decodeChunk, &buffer, firstChunk, endChunk, batchStart]() {
+			ParallelFor(endChunk - firstChunk, [&](int32 i) {
+				decodeChunk(firstChunk + i, buffer.GetData() + (mChunks[firstChunk + i].Offset - batchStart));
+			});
+		});
+		firstChunk = endChunk;
+	}
+	if (decodeTask.IsValid())
+		decodeTask.Wait();
+
+	if (outStats) {
+		outStats->PointCount = mHeader.PointCount;
+		outStats->RawBytes = (int64)mHeader.PointCount * (sizeof(FLinearColor) + 4);
+		outStats->FileBytes = mReader->TotalSize();
+		outStats->IOSeconds = ioSeconds;
+		outStats->CodecSeconds = FPlatformTime::Seconds() - startTime - ioSeconds;
+	}
+
+	mReadBuffers[0].Empty();
+	mReadBuffers[1].Empty();
+	return !readFailed && failedChunks.GetValue() == 0;
+}
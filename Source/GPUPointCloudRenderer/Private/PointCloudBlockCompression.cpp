@@ -0,0 +1,353 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudBlockCompression.h"
+
+namespace PointCloudBlockCompression
+{
+	/** The interpolation weights of 4-bit BC7 indices. */
+	const int32 BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/** A 4x4 block in RGBA (texels in row-major order). */
+	typedef float FBlockColors[16][4];
+
+	/** Writes the bits of a 128-bit block, starting with the least significant bit. */
+	struct FBlockBitWriter
+	{
+		uint64 Bits[2] = { 0, 0 };
+		int32 Position = 0;
+
+		void Write(uint32 value, int32 bitCount)
+		{
+			if (Position < 64) {
+				Bits[0] |= (uint64)value << Position;
+				if (Position + bitCount > 64)
+					Bits[1] |= (uint64)value >> (64 - Position);
+			}
+			else {
+				Bits[1] |= (uint64)value << (Position - 64);
+			}
+			Position += bitCount;
+		}
+	};
+
+	/** Approximates the principal axis of the block colors by power iteration, starting from the bounding box diagonal. */
+	void ComputePrincipalAxis(const FBlockColors &colors, int32 channelCount, float (&outMean)[4], float (&outAxis)[4])
+	{
+		float minColor[4] = { 255.f, 255.f, 255.f, 255.f };
+		float maxColor[4] = { 0.f, 0.f, 0.f, 0.f };
+		for (int32 c = 0; c < 4; ++c)
+			outMean[c] = 0.f;
+		for (int32 i = 0; i < 16; ++i) {
+			for (int32 c = 0; c < channelCount; ++c) {
+				outMean[c] += colors[i][c] / 16.f;
+				minColor[c] = FMath::Min(minColor[c], colors[i][c]);
+				maxColor[c] = FMath::Max(maxColor[c], colors[i][c]);
+			}
+		}
+
+		float covariance[4][4] = {};
+		for (int32 i = 0; i < 16; ++i) {
+			for (int32 a = 0; a < channelCount; ++a)
+				for (int32 b = a; b < channelCount; ++b)
+					covariance[a][b] += (colors[i][a] - outMean[a]) * (colors[i][b] - outMean[b]);
+		}
+		for (int32 a = 0; a < channelCount; ++a)
+			for (int32 b = 0; b < a; ++b)
+				covariance[a][b] = covariance[b][a];
+
+		for (int32 c = 0; c < 4; ++c)
+			outAxis[c] = c < channelCount ? maxColor[c] - minColor[c] : 0.f;
+
+		for (int32 iteration = 0; iteration < 8; ++iteration) {
+			float next[4] = { 0.f, 0.f, 0.f, 0.f };
+			float norm = 0.f;
+			for (int32 a = 0; a < channelCount; ++a) {
+				for (int32 b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * outAxis[b];
+				norm = FMath::Max(norm, FMath::Abs(next[a]));
+			}
+			if (norm <= SMALL_NUMBER)
+				break;
+			for (int32 a = 0; a < channelCount; ++a)
+				outAxis[a] = next[a] / norm;
+		}
+
+		float length = 0.f;
+		for (int32 c = 0; c < channelCount; ++c)
+			length += outAxis[c] * outAxis[c];
+		length = FMath::Sqrt(length);
+		for (int32 c = 0; c < channelCount; ++c)
+			outAxis[c] = length > SMALL_NUMBER ? outAxis[c] / length : 0.f;
+	}
+
+	/** The colors at both ends of the projection onto the principal axis. */
+	void ComputeEndpoints(const FBlockColors &colors, int32 channelCount, float (&outLow)[4], float (&outHigh)[4])
+	{
+		float mean[4];
+		float axis[4];
+		ComputePrincipalAxis(colors, channelCount, mean, axis);
+
+		float minT = 0.f;
+		float maxT = 0.f;
+		for (int32 i = 0; i < 16; ++i) {
+			float t = 0.f;
+			for (int32 c = 0; c < channelCount; ++c)
+				t += (colors[i][c] - mean[c]) * axis[c];
+			minT = FMath::Min(minT, t);
+			maxT = FMath::Max(maxT, t);
+		}
+
+		for (int32 c = 0; c < 4; ++c) {
+			outLow[c] = c < channelCount ? FMath::Clamp(mean[c] + axis[c] * minT, 0.f, 255.f) : 255.f;
+			outHigh[c] = c < channelCount ? FMath::Clamp(mean[c] + axis[c] * maxT, 0.f, 255.f) : 255.f;
+		}
+	}
+
+	float GetSquaredError(const float (&color)[4], const int32 (&reference)[4])
+	{
+		const float r = color[0] - reference[0];
+		const float g = color[1] - reference[1];
+		const float b = color[2] - reference[2];
+		return r * r + g * g + b * b;
+	}
+
+	uint16 ToRGB565(const float (&color)[4])
+	{
+		const uint32 r = (uint32)FMath::Clamp(FMath::RoundToInt(color[0] * 31.f / 255.f), 0, 31);
+		const uint32 g = (uint32)FMath::Clamp(FMath::RoundToInt(color[1] * 63.f / 255.f), 0, 63);
+		const uint32 b = (uint32)FMath::Clamp(FMath::RoundToInt(color[2] * 31.f / 255.f), 0, 31);
+		return (uint16)((r << 11) | (g << 5) | b);
+	}
+
+	void FromRGB565(uint16 color, int32 (&outColor)[4])
+	{
+		const int32 r = (color >> 11) & 31;
+		const int32 g = (color >> 5) & 63;
+		const int32 b = color & 31;
+		outColor[0] = (r << 3) | (r >> 2);
+		outColor[1] = (g << 2) | (g >> 4);
+		outColor[2] = (b << 3) | (b >> 2);
+		outColor[3] = 255;
+	}
+
+	/** Encodes an opaque BC1 block (4-color mode). */
+	void EncodeBC1Block(const FBlockColors &colors, uint8* outBlock, float (&outErrors)[16])
+	{
+		float low[4];
+		float high[4];
+		ComputeEndpoints(colors, 3, low, high);
+
+		uint16 color0 = ToRGB565(high);
+		uint16 color1 = ToRGB565(low);
+		if (color0 < color1)
+			Swap(color0, color1);
+
+		int32 palette[4][4];
+		FromRGB565(color0, palette[0]);
+		FromRGB565(color1, palette[1]);
+		for (int32 c = 0; c < 4; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+
+		// Equal endpoints switch the block to 3-color mode, where only index 0 is safe to use
+		const int32 paletteSize = color0 == color1 ? 1 : 4;
+		uint32 indices = 0;
+		for (int32 i = 0; i < 16; ++i) {
+			int32 bestIndex = 0;
+			float bestError = GetSquaredError(colors[i], palette[0]);
+			for (int32 p = 1; p < paletteSize; ++p) {
+				const float error = GetSquaredError(colors[i], palette[p]);
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices |= (uint32)bestIndex << (2 * i);
+			outErrors[i] = bestError;
+		}
+
+		const uint64 block = (uint64)color0 | ((uint64)color1 << 16) | ((uint64)indices << 32);
+		FMemory::Memcpy(outBlock, &block, sizeof(uint64));
+	}
+
+	/** Quantizes a BC7 mode 6 endpoint: 7 bits per channel plus a p-bit shared by all channels of the endpoint. */
+	void QuantizeBC7Endpoint(const float (&color)[4], uint32 (&outQuantized)[4], uint32 &outPBit, int32 (&outColor)[4])
+	{
+		float bestError = MAX_flt;
+		for (uint32 pBit = 0; pBit < 2; ++pBit) {
+			uint32 quantized[4];
+			int32 expanded[4];
+			float error = 0.f;
+			for (int32 c = 0; c < 4; ++c) {
+				quantized[c] = (uint32)FMath::Clamp(FMath::RoundToInt((color[c] - pBit) * 0.5f), 0, 127);
+				expanded[c] = (int32)((quantized[c] << 1) | pBit);
+				error += FMath::Square(color[c] - expanded[c]);
+			}
+			if (error < bestError) {
+				bestError = error;
+				outPBit = pBit;
+				for (int32 c = 0; c < 4; ++c) {
+					outQuantized[c] = quantized[c];
+					outColor[c] = expanded[c];
+				}
+			}
+		}
+	}
+
+	/** Encodes a BC7 mode 6 block (single subset, RGBA endpoints, 4-bit indices). */
+	void EncodeBC7Block(const FBlockColors &colors, uint8* outBlock, float (&outErrors)[16])
+	{
+		float low[4];
+		float high[4];
+		ComputeEndpoints(colors, 4, low, high);
+
+		uint32 quantized[2][4];
+		uint32 pBits[2];
+		int32 endpoints[2][4];
+		QuantizeBC7Endpoint(low, quantized[0], pBits[0], endpoints[0]);
+		QuantizeBC7Endpoint(high, quantized[1], pBits[1], endpoints[1]);
+
+		int32 palette[16][4];
+		for (int32 p = 0; p < 16; ++p)
+			for (int32 c = 0; c < 4; ++c)
+				palette[p][c] = ((64 - BC7Weights[p]) * endpoints[0][c] + BC7Weights[p] * endpoints[1][c] + 32) >> 6;
+
+		uint32 indices[16];
+		for (int32 i = 0; i < 16; ++i) {
+			uint32 bestIndex = 0;
+			float bestError = MAX_flt;
+			for (int32 p = 0; p < 16; ++p) {
+				const float error = GetSquaredError(colors[i], palette[p]) + FMath::Square(colors[i][3] - palette[p][3]);
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices[i] = bestIndex;
+			outErrors[i] = GetSquaredError(colors[i], palette[bestIndex]);
+		}
+
+		// The most significant bit of the first index is implicitly 0, which is achieved by swapping the endpoints (the weights are symmetric)
+		if (indices[0] & 8) {
+			for (int32 c = 0; c < 4; ++c)
+				Swap(quantized[0][c], quantized[1][c]);
+			Swap(pBits[0], pBits[1]);
+			for (int32 i = 0; i < 16; ++i)
+				indices[i] = 15 - indices[i];
+		}
+
+		FBlockBitWriter writer;
+		writer.Write(1 << 6, 7);		// Mode 6
+		for (int32 c = 0; c < 4; ++c) {
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (int32 i = 1; i < 16; ++i)
+			writer.Write(indices[i], 4);
+
+		FMemory::Memcpy(outBlock, writer.Bits, 2 * sizeof(uint64));
+	}
+}
+
+using namespace PointCloudBlockCompression;
+
+FString FPointCloudColorCompressionStats::ToString() const
+{
+	return FString::Printf(TEXT("%d points, %.1f MB -> %.1f MB (%.1fx), encoded in %.1f ms (%.1f M points/s), RMS error %.2f"),
+		PointCount, UncompressedBytes / (1024.0 * 1024.0), CompressedBytes / (1024.0 * 1024.0), CompressedBytes > 0 ? (double)UncompressedBytes / CompressedBytes : 0.0,
+		EncodeSeconds * 1000.0, EncodeSeconds > 0.0 ? PointCount / EncodeSeconds / 1000000.0 : 0.0, RmsError);
+}
+
+EPixelFormat FPointCloudBlockEncoder::GetPixelFormat(EPointCloudColorFormat format)
+{
+	switch (format) {
+	case EPointCloudColorFormat::BC1:
+		return PF_DXT1;
+	case EPointCloudColorFormat::BC7:
+		return PF_BC7;
+	default:
+		return PF_B8G8R8A8;
+	}
+}
+
+void FPointCloudBlockEncoder::BuildBlockLinearLayout(int32 textureSize, int32 pointCount, TArray<int32> &outIndices)
+{
+	const int32 blocksPerRow = textureSize / 4;
+	outIndices.SetNumUninitialized(textureSize * textureSize, false);
+	pointCount = FMath::Clamp(pointCount, 1, textureSize * textureSize);
+
+	// A full block row covers the same texels in row-major and block-linear order, so the points can be permuted within it
+	const int32 linearTexelCount = pointCount / (4 * textureSize) * (4 * textureSize);
+
+	ParallelFor(textureSize, [&](int32 y) {
+		for (int32 x = 0; x < textureSize; ++x) {
+			const int32 texel = y * textureSize + x;
+			if (texel < linearTexelCount) {
+				outIndices[texel] = ((y / 4) * blocksPerRow + x / 4) * 16 + (y % 4) * 4 + x % 4;
+			}
+			else if (texel < pointCount) {
+				outIndices[texel] = texel;
+			}
+			else {
+				// Not drawn, repeats the texel in the top row of the block (or the last point)
+				const int32 blockTexel = (y & ~3) * textureSize + x;
+				outIndices[texel] = blockTexel < pointCount ? blockTexel : pointCount - 1;
+			}
+		}
+	});
+}
+
+float FPointCloudBlockEncoder::Encode(const uint8* texels, int32 textureSize, EPointCloudColorFormat format, int32 errorTexelCount, TArray<uint8> &outBlocks)
+{
+	const int32 blocksPerRow = textureSize / 4;
+	const int32 blockBytes = GetBlockBytes(format);
+	const bool useBC7 = format == EPointCloudColorFormat::BC7;
+	outBlocks.SetNumUninitialized(blocksPerRow * blocksPerRow * blockBytes, false);
+
+	TArray<double> rowErrors;
+	rowErrors.SetNumZeroed(blocksPerRow);
+
+	ParallelFor(blocksPerRow, [&](int32 blockY) {
+
+		FBlockColors colors;
+		float errors[16];
+		double rowError = 0.0;
+
+		for (int32 blockX = 0; blockX < blocksPerRow; ++blockX) {
+
+			// The texture is BGRA8
+			for (int32 i = 0; i < 16; ++i) {
+				const uint8* texel = texels + ((blockY * 4 + i / 4) * textureSize + blockX * 4 + i % 4) * 4;
+				colors[i][0] = texel[2];
+				colors[i][1] = texel[1];
+				colors[i][2] = texel[0];
+				colors[i][3] = texel[3];
+			}
+
+			uint8* block = outBlocks.GetData() + (blockY * blocksPerRow + blockX) * blockBytes;
+			if (useBC7)
+				EncodeBC7Block(colors, block, errors);
+			else
+				EncodeBC1Block(colors, block, errors);
+
+			for (int32 i = 0; i < 16; ++i) {
+				if ((blockY * 4 + i / 4) * textureSize + blockX * 4 + i % 4 < errorTexelCount)
+					rowError += errors[i];
+			}
+		}
+
+		rowErrors[blockY] = rowError;
+	});
+
+	double squaredError = 0.0;
+	for (const double rowError : rowErrors)
+		squaredError += rowError;
+	errorTexelCount = FMath::Min(errorTexelCount, textureSize * textureSize);
+	return errorTexelCount > 0 ? (float)FMath::Sqrt(squaredError / (errorTexelCount * 3.0)) : 0.f;
+}
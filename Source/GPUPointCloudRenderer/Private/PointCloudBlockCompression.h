@@ -0,0 +1,61 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PointCloudStreamingCore.h"
+#include "Async/ParallelFor.h"
+
+/**
+ * Multi-threaded CPU block compression of the color texture of static point clouds.
+ * BC1 stores a 4x4 texel block in 8 bytes (0.5 bytes per point), BC7 in 16 bytes (1 byte per point, mode 6 only).
+ * As every point is a single texel, the points are laid out block-linear beforehand: 16 consecutive points of the
+ * curve-sorted point order fill one 4x4 block, so every block holds spatially close and therefore similar colors.
+ * The points keep their texel range, so the drawn point count is not changed by the layout.
+ */
+class FPointCloudBlockEncoder
+{
+public:
+	/**
+	* Computes the block-linear layout of a square texture. Only the full block rows (4 texture rows) are laid out block-linear,
+	* the points of the last, partial block row keep their order, so all points stay in the first pointCount texels.
+	* The texels behind the points repeat a point of their block, so they do not disturb its colors.
+	*
+	* @param	textureSize					The texture width and height, a multiple of 4.
+	* @param	pointCount					The number of valid points.
+	* @param	outIndices					The point index of every texel.
+	*/
+	static void BuildBlockLinearLayout(int32 textureSize, int32 pointCount, TArray<int32> &outIndices);
+
+	/** Gathers the point of every texel (see BuildBlockLinearLayout()) in place. */
+	template<typename T>
+	static void ApplyLayout(T* data, const TArray<int32> &indices, TArray<T> &scratch)
+	{
+		const int32 texelCount = indices.Num();
+		scratch.SetNumUninitialized(texelCount, false);
+		ParallelFor(FMath::DivideAndRoundUp(texelCount, 16384), [&](int32 chunk) {
+			const int32 start = chunk * 16384;
+			const int32 end = FMath::Min(start + 16384, texelCount);
+			for (int32 i = start; i < end; ++i)
+				scratch[i] = data[indices[i]];
+		});
+		FMemory::Memcpy(data, scratch.GetData(), texelCount * sizeof(T));
+	}
+
+	/**
+	* Encodes the texels of the uncompressed color texture (BGRA8) into BC1 or BC7 blocks, in parallel over the block rows.
+	*
+	* @param	texels						The texels, textureSize * textureSize * 4 bytes.
+	* @param	textureSize					The texture width and height, a multiple of 4.
+	* @param	format						BC1 or BC7.
+	* @param	errorTexelCount				The number of leading texels the returned error is computed for.
+	* @param	outBlocks					The encoded blocks in row-major block order.
+	* @return	The RMS error of the RGB channels in 8-bit steps.
+	*/
+	static float Encode(const uint8* texels, int32 textureSize, EPointCloudColorFormat format, int32 errorTexelCount, TArray<uint8> &outBlocks);
+
+	static int32 GetBlockBytes(EPointCloudColorFormat format) { return format == EPointCloudColorFormat::BC7 ? 16 : 8; };
+	static EPixelFormat GetPixelFormat(EPointCloudColorFormat format);
+};
@@ -0,0 +1,189 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudDensityEstimator.h"
+#include "PointCloudLayout.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	const int32 ParallelChunkSize = 16384;
+	const int32 MaxSearchRings = 8;
+	const int64 MaxCellsPerPoint = 4;
+	const int64 MaxCellCount = 1 << 26;
+}
+
+void FPointCloudDensityEstimator::Build(const FLinearColor* pointPositions, int32 pointCount, int32 pointsPerCell)
+{
+	mPointCount = pointCount;
+	if (!pointPositions || pointCount <= 0)
+		return;
+
+	const int32 numChunks = FMath::DivideAndRoundUp(pointCount, ParallelChunkSize);
+
+	// Compute the bounds of the cloud (parallel reduction over chunks)
+	mChunkBounds.SetNumUninitialized(numChunks, false);
+	ParallelFor(numChunks, [&](int32 chunk) {
+
+		const int32 start = chunk * ParallelChunkSize;
+		const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+		FVector minPos(BIG_NUMBER), maxPos(-BIG_NUMBER);
+
+		for (int32 i = start; i < end; ++i) {
+			const FVector pos = PointCloudLayout::UnpackPosition(pointPositions[i]);
+			minPos = minPos.ComponentMin(pos);
+			maxPos = maxPos.ComponentMax(pos);
+		}
+		mChunkBounds[chunk] = FBox(minPos, maxPos);
+	});
+
+	FBox bounds(ForceInit);
+	for (const FBox &chunkBox : mChunkBounds)
+		bounds += chunkBox;
+
+	// Choose the cell size from the surface area, since scanned clouds are mostly 2.5D surfaces
+	FVector size = bounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	float dims[3] = { size.X, size.Y, size.Z };
+	if (dims[0] < dims[1]) Swap(dims[0], dims[1]);
+	if (dims[1] < dims[2]) Swap(dims[1], dims[2]);
+	if (dims[0] < dims[1]) Swap(dims[0], dims[1]);
+
+	float cellSize = FMath::Max(FMath::Sqrt(dims[0] * dims[1] * FMath::Max(pointsPerCell, 1) / (float)pointCount), KINDA_SMALL_NUMBER);
+	const int64 maxCells = FMath::Min(MaxCellCount, FMath::Max<int64>(pointCount * MaxCellsPerPoint, 1));
+	for (;;) {
+		mResolution = FIntVector(
+			FMath::Max(FMath::CeilToInt(size.X / cellSize), 1),
+			FMath::Max(FMath::CeilToInt(size.Y / cellSize), 1),
+			FMath::Max(FMath::CeilToInt(size.Z / cellSize), 1));
+		if ((int64)mResolution.X * mResolution.Y * mResolution.Z <= maxCells)
+			break;
+		cellSize *= 1.25f;
+	}
+
+	mMin = bounds.Min;
+	mCellSize = cellSize;
+	mInvCellSize = 1.f / cellSize;
+	const int32 cellCount = mResolution.X * mResolution.Y * mResolution.Z;
+
+	// Histogram of the cell occupancy
+	mPointCells.SetNumUninitialized(pointCount, false);
+	mCellStart.SetNumUninitialized(cellCount + 1, false);
+	FMemory::Memzero(mCellStart.GetData(), mCellStart.Num() * sizeof(int32));
+
+	ParallelFor(numChunks, [&](int32 chunk) {
+
+		const int32 start = chunk * ParallelChunkSize;
+		const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+
+		for (int32 i = start; i < end; ++i) {
+			const int32 cell = GetCellIndex(GetCell(PointCloudLayout::UnpackPosition(pointPositions[i])));
+			mPointCells[i] = cell;
+			FPlatformAtomics::InterlockedIncrement(&mCellStart[cell + 1]);
+		}
+	});
+
+	for (int32 i = 1; i <= cellCount; ++i)
+		mCellStart[i] += mCellStart[i - 1];
+
+	// Scatter the points into cell order
+	mCellCursor.SetNumUninitialized(cellCount, false);
+	FMemory::Memcpy(mCellCursor.GetData(), mCellStart.GetData(), cellCount * sizeof(int32));
+	mSortedIndices.SetNumUninitialized(pointCount, false);
+	mSortedPositions.SetNumUninitialized(pointCount, false);
+
+	ParallelFor(numChunks, [&](int32 chunk) {
+
+		const int32 start = chunk * ParallelChunkSize;
+		const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+
+		for (int32 i = start; i < end; ++i) {
+			const int32 slot = FPlatformAtomics::InterlockedIncrement(&mCellCursor[mPointCells[i]]) - 1;
+			mSortedIndices[slot] = i;
+			mSortedPositions[slot] = PointCloudLayout::UnpackPosition(pointPositions[i]);
+		}
+	});
+}
+
+float FPointCloudDensityEstimator::FindKthNeighbourDistance(int32 sortedIndex, int32 neighbourCount) const
+{
+	const FVector pos = mSortedPositions[sortedIndex];
+	const FIntVector center = GetCell(pos);
+
+	// Small max-"heap" of the k best squared distances (k is tiny, so linear updates are fastest)
+	float best[MaxNeighbourCount];
+	int32 found = 0;
+	int32 worstIndex = 0;
+
+	int32 ring = 0;
+	for (; ring <= MaxSearchRings; ++ring) {
+
+		const FIntVector minCell(FMath::Max(center.X - ring, 0), FMath::Max(center.Y - ring, 0), FMath::Max(center.Z - ring, 0));
+		const FIntVector maxCell(FMath::Min(center.X + ring, mResolution.X - 1), FMath::Min(center.Y + ring, mResolution.Y - 1), FMath::Min(center.Z + ring, mResolution.Z - 1));
+
+		for (int32 z = minCell.Z; z <= maxCell.Z; ++z) {
+			for (int32 y = minCell.Y; y <= maxCell.Y; ++y) {
+				for (int32 x = minCell.X; x <= maxCell.X; ++x) {
+
+					// Only visit the shell of the current ring
+					const int32 chebyshev = FMath::Max3(FMath::Abs(x - center.X), FMath::Abs(y - center.Y), FMath::Abs(z - center.Z));
+					if (chebyshev != ring)
+						continue;
+
+					const int32 cell = GetCellIndex(FIntVector(x, y, z));
+					for (int32 j = mCellStart[cell]; j < mCellStart[cell + 1]; ++j) {
+
+						if (j == sortedIndex)
+							continue;
+
+						const float distSq = FVector::DistSquared(pos, mSortedPositions[j]);
+						if (found < neighbourCount) {
+							best[found] = distSq;
+							if (distSq > best[worstIndex]) worstIndex = found;
+							found++;
+						}
+						else if (distSq < best[worstIndex]) {
+							best[worstIndex] = distSq;
+							for (int32 k = 0; k < neighbourCount; ++k)
+								if (best[k] > best[worstIndex]) worstIndex = k;
+						}
+					}
+				}
+			}
+		}
+
+		// All unvisited cells are at least ring * cellSize away
+		const float ringDistance = ring * mCellSize;
+		if (found == neighbourCount && best[worstIndex] <= ringDistance * ringDistance)
+			break;
+
+		// Whole grid covered
+		if (minCell == FIntVector::ZeroValue && maxCell == mResolution - FIntVector(1, 1, 1))
+			break;
+	}
+
+	if (found < neighbourCount)
+		return (FMath::Min(ring, MaxSearchRings) + 1) * mCellSize;
+
+	return FMath::Sqrt(best[worstIndex]);
+}
+
+void FPointCloudDensityEstimator::ComputeNeighbourDistances(int32 neighbourCount, TArray<float> &outDistances) const
+{
+	outDistances.SetNumUninitialized(mPointCount, false);
+	if (mPointCount <= 0)
+		return;
+
+	neighbourCount = FMath::Clamp(neighbourCount, 1, (int32)MaxNeighbourCount);
+	const int32 numChunks = FMath::DivideAndRoundUp(mPointCount, ParallelChunkSize);
+
+	// Iterate in cell order, so neighbouring threads work on neighbouring cells
+	ParallelFor(numChunks, [&](int32 chunk) {
+
+		const int32 start = chunk * ParallelChunkSize;
+		const int32 end = FMath::Min(start + ParallelChunkSize, mPointCount);
+
+		for (int32 i = start; i < end; ++i)
+			outDistances[mSortedIndices[i]] = FindKthNeighbourDistance(i, neighbourCount);
+	});
+}
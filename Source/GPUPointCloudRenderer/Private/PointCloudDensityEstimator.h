@@ -0,0 +1,69 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over a point cloud for fast, multi-threaded k-nearest-neighbour queries.
+ * Used to estimate the local point density, e.g. for adaptive splat sizes.
+ * All buffers are kept between builds, so rebuilding for every snapshot does not reallocate.
+ */
+class FPointCloudDensityEstimator
+{
+public:
+	/** The maximum supported k for neighbour queries. */
+	static const int32 MaxNeighbourCount = 32;
+
+	/**
+	* Bins the given points (packed position layout) into a uniform grid.
+	*
+	* @param	pointPositions				The packed point positions.
+	* @param	pointCount					The number of valid points.
+	* @param	pointsPerCell				The targeted average number of points per occupied cell.
+	*/
+	void Build(const FLinearColor* pointPositions, int32 pointCount, int32 pointsPerCell = 8);
+
+	/**
+	* Computes the distance of every point to its k-th nearest neighbour (in parallel).
+	*
+	* @param	neighbourCount				k, clamped to [1, MaxNeighbourCount].
+	* @param	outDistances				The distances, indexed like the input points.
+	*/
+	void ComputeNeighbourDistances(int32 neighbourCount, TArray<float> &outDistances) const;
+
+	int32 GetPointCount() const { return mPointCount; };
+	float GetCellSize() const { return mCellSize; };
+
+private:
+	float FindKthNeighbourDistance(int32 sortedIndex, int32 neighbourCount) const;
+
+	FORCEINLINE FIntVector GetCell(const FVector &position) const
+	{
+		const FVector local = (position - mMin) * mInvCellSize;
+		return FIntVector(
+			FMath::Clamp(FMath::FloorToInt(local.X), 0, mResolution.X - 1),
+			FMath::Clamp(FMath::FloorToInt(local.Y), 0, mResolution.Y - 1),
+			FMath::Clamp(FMath::FloorToInt(local.Z), 0, mResolution.Z - 1));
+	}
+
+	FORCEINLINE int32 GetCellIndex(const FIntVector &cell) const
+	{
+		return (cell.Z * mResolution.Y + cell.Y) * mResolution.X + cell.X;
+	}
+
+	int32 mPointCount = 0;
+	FVector mMin = FVector::ZeroVector;
+	float mCellSize = 1.f;
+	float mInvCellSize = 1.f;
+	FIntVector mResolution = FIntVector(1, 1, 1);
+
+	TArray<FBox> mChunkBounds;
+	TArray<int32> mPointCells;			// Grid cell of every input point
+	TArray<int32> mCellStart;			// Prefix sum over the cell histogram (cell count + 1 entries)
+	TArray<int32> mCellCursor;
+	TArray<int32> mSortedIndices;		// Input index of every point in cell order
+	TArray<FVector> mSortedPositions;	// Point positions in cell order for cache-friendly searches
+};
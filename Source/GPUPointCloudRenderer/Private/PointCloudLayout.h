@@ -0,0 +1,39 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Helpers for the packed point layout used by the position texture:
+ *	Alpha Channel : Z-values;
+ *	Green Channel : X-values;
+ *	Blue Channel : Y-values;
+ *	Red Channel : Z-values;
+ */
+namespace PointCloudLayout
+{
+	FORCEINLINE FVector UnpackPosition(const FLinearColor& packed)
+	{
+		return FVector(packed.G, packed.B, packed.R);
+	}
+
+	FORCEINLINE void PackPosition(const FVector& position, FLinearColor& outPacked)
+	{
+		outPacked.A = position.Z;
+		outPacked.G = position.X;
+		outPacked.B = position.Y;
+		outPacked.R = position.Z;
+	}
+
+	/** The 4 color bytes of a point (R, G, B, A in memory) as a single word. */
+	FORCEINLINE uint32 PackColor(const FColor& color)
+	{
+		const uint8 bytes[4] = { color.R, color.G, color.B, color.A };
+		uint32 packed;
+		FMemory::Memcpy(&packed, bytes, sizeof(uint32));
+		return packed;
+	}
+}
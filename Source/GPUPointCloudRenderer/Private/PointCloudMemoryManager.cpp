@@ -0,0 +1,130 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudMemoryManager.h"
+#include "PointCloudStreamingCore.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPointCloudMemory, Log, All);
+
+DECLARE_MEMORY_STAT(TEXT("Point Cloud Texture Memory"), STAT_PointCloudTextureMemory, STATGROUP_GPUPCR);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Registered Point Clouds"), STAT_RegisteredPointClouds, STATGROUP_GPUPCR);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evicted Point Clouds"), STAT_EvictedPointClouds, STATGROUP_GPUPCR);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Point Cloud Evictions"), STAT_PointCloudEvictions, STATGROUP_GPUPCR);
+
+static TAutoConsoleVariable<int32> CVarMemoryBudgetMB(
+	TEXT("r.GPUPointCloud.MemoryBudgetMB"),
+	1024,
+	TEXT("Texture memory budget of all GPU point clouds in MB. The least recently visible clouds are evicted when it is exceeded. 0 disables the budget."),
+	ECVF_Default);
+
+FPointCloudMemoryManager& FPointCloudMemoryManager::Get()
+{
+	static FPointCloudMemoryManager instance;
+	return instance;
+}
+
+int64 FPointCloudMemoryManager::GetBudgetBytes() const
+{
+	return (int64)FMath::Max(CVarMemoryBudgetMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+}
+
+void FPointCloudMemoryManager::Register(FPointCloudStreamingCore* core)
+{
+	FScopeLock lock(&mLock);
+	mEntries.Add(core).LastVisibleTime = FPlatformTime::Seconds();
+	SET_DWORD_STAT(STAT_RegisteredPointClouds, mEntries.Num());
+}
+
+void FPointCloudMemoryManager::Unregister(FPointCloudStreamingCore* core)
+{
+	FScopeLock lock(&mLock);
+	FEntry entry;
+	if (mEntries.RemoveAndCopyValue(core, entry)) {
+		mResidentBytes -= entry.ResidentBytes;
+		if (entry.bEvicted)
+			DEC_DWORD_STAT(STAT_EvictedPointClouds);
+	}
+	SET_DWORD_STAT(STAT_RegisteredPointClouds, mEntries.Num());
+	SET_MEMORY_STAT(STAT_PointCloudTextureMemory, mResidentBytes);
+}
+
+void FPointCloudMemoryManager::UpdateResidentBytes(FPointCloudStreamingCore* core, int64 bytes)
+{
+	FScopeLock lock(&mLock);
+	FEntry* entry = mEntries.Find(core);
+	if (!entry)
+		return;
+
+	const int64 previousBytes = entry->ResidentBytes;
+	mResidentBytes += bytes - previousBytes;
+	entry->ResidentBytes = bytes;
+	SET_MEMORY_STAT(STAT_PointCloudTextureMemory, mResidentBytes);
+
+	// New textures (e.g. new input) make an evicted core resident again
+	if (bytes > 0 && entry->bEvicted) {
+		entry->bEvicted = false;
+		DEC_DWORD_STAT(STAT_EvictedPointClouds);
+	}
+
+	if (bytes > previousBytes)
+		EnforceBudget(core);
+}
+
+void FPointCloudMemoryManager::MarkVisible(FPointCloudStreamingCore* core)
+{
+	bool restore = false;
+	{
+		FScopeLock lock(&mLock);
+		FEntry* entry = mEntries.Find(core);
+		if (!entry)
+			return;
+
+		entry->LastVisibleTime = FPlatformTime::Seconds();
+		entry->LastVisibleFrame = GFrameCounter;
+		restore = entry->bEvicted;
+	}
+
+	// Re-creating the textures reports the new size, which in turn evicts other cores if necessary
+	if (restore)
+		core->RestoreTextures();
+}
+
+void FPointCloudMemoryManager::EnforceBudget(FPointCloudStreamingCore* requester)
+{
+	const int64 budget = GetBudgetBytes();
+	if (budget <= 0 || mResidentBytes <= budget || mIsEvicting)
+		return;
+
+	// Least recently visible first. Cores that are visible in this frame and the requester itself are never evicted
+	TArray<TPair<double, FPointCloudStreamingCore*>> candidates;
+	for (const auto &pair : mEntries) {
+		const FEntry &entry = pair.Value;
+		if (pair.Key != requester && !entry.bEvicted && entry.ResidentBytes > 0 && entry.LastVisibleFrame + 1 < GFrameCounter)
+			candidates.Emplace(entry.LastVisibleTime, pair.Key);
+	}
+	candidates.Sort([](const TPair<double, FPointCloudStreamingCore*> &a, const TPair<double, FPointCloudStreamingCore*> &b) { return a.Key < b.Key; });
+
+	mIsEvicting = true;
+	for (const auto &candidate : candidates) {
+
+		if (mResidentBytes <= budget)
+			break;
+
+		FEntry &entry = mEntries[candidate.Value];
+		candidate.Value->EvictTextures();
+
+		// EvictTextures() reports 0 resident bytes
+		entry.bEvicted = true;
+		mEvictionCount++;
+		INC_DWORD_STAT(STAT_EvictedPointClouds);
+		INC_DWORD_STAT(STAT_PointCloudEvictions);
+	}
+	mIsEvicting = false;
+
+	if (mResidentBytes > budget)
+		UE_LOG(LogPointCloudMemory, Warning, TEXT("Point cloud texture memory (%lld MB) exceeds the budget of %lld MB, all remaining point clouds are visible."), mResidentBytes / (1024 * 1024), budget / (1024 * 1024));
+}
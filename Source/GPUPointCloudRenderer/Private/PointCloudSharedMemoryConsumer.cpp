@@ -0,0 +1,128 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudSharedMemoryConsumer.h"
+#include "PointCloudStreamingCore.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include "Windows/MinWindows.h"
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+using namespace PointCloudSharedMemory;
+
+/** FPlatformMemory always opens segments in the Global namespace on Windows, segments in the Local namespace are mapped here. */
+static FPlatformMemory::FSharedMemoryRegion* MapSegment(const FString &segmentName, bool globalNamespace, uint32 accessMode, SIZE_T size)
+{
+#if PLATFORM_WINDOWS
+	if (!globalNamespace) {
+		const FString name = FString(TEXT("Local\\")) + segmentName;
+		HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, *name);
+		if (!mapping)
+			return nullptr;
+		void* address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (!address) {
+			CloseHandle(mapping);
+			return nullptr;
+		}
+		return new FWindowsPlatformMemory::FWindowsSharedMemoryRegion(name, accessMode, address, size, mapping);
+	}
+#endif
+	return FPlatformMemory::MapNamedSharedMemoryRegion(segmentName, false, accessMode, size);
+}
+
+bool FPointCloudSharedMemoryConsumer::Connect(const FString &segmentName, bool globalNamespace)
+{
+	Disconnect();
+
+	const uint32 accessMode = FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write;
+
+	// Map the header first to find out the size of the whole segment
+	FPlatformMemory::FSharedMemoryRegion* headerRegion = MapSegment(segmentName, globalNamespace, accessMode, sizeof(SegmentHeader));
+	if (!headerRegion)
+		return false;
+
+	const SegmentHeader* header = (const SegmentHeader*)headerRegion->GetAddress();
+	const bool isValid = header->Magic == Magic && header->Version == Version && header->SlotCount >= 2 && header->TextureSize <= MAXTEXRES;
+	FPlatformMisc::MemoryBarrier();
+	const uint64 totalSize = header->TotalSize;
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(headerRegion);
+
+	if (!isValid)
+		return false;
+
+	mRegion = MapSegment(segmentName, globalNamespace, accessMode, totalSize);
+	if (!mRegion)
+		return false;
+
+	mHeader = (SegmentHeader*)mRegion->GetAddress();
+	mLastSequence = mHeader->ReadSequence.load(std::memory_order_acquire);
+	mSkippedFrames = 0;
+	return true;
+}
+
+void FPointCloudSharedMemoryConsumer::Disconnect()
+{
+	// The render thread might still read from the mapped frame
+	if (mIsFrameInFlight)
+		mUploadFence.Wait();
+	if (mIsHoldingFrame)
+		ReleaseFrame();
+
+	if (mRegion)
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(mRegion);
+	mRegion = nullptr;
+	mHeader = nullptr;
+}
+
+bool FPointCloudSharedMemoryConsumer::AcquireLatestFrame(const FLinearColor* &outPositions, const uint8* &outColors, uint32 &outPointCount, double &outTimestamp)
+{
+	if (!mHeader)
+		return false;
+
+	if (mIsFrameInFlight && !mUploadFence.IsFenceComplete())
+		return false;
+	if (mIsHoldingFrame)
+		ReleaseFrame();
+
+	const uint64 writeSequence = mHeader->WriteSequence.load(std::memory_order_acquire);
+	if (writeSequence == 0 || writeSequence <= mLastSequence)
+		return false;
+
+	const uint64 sequence = writeSequence - 1;
+	SlotHeader* slot = GetSlot(mHeader, sequence);
+	if (slot->Sequence.load(std::memory_order_acquire) != writeSequence)
+		return false;
+
+	// Skipped frames are handed back to the producer right away
+	mSkippedFrames += sequence - mLastSequence;
+	mHeader->ReadSequence.store(sequence, std::memory_order_release);
+	mLastSequence = writeSequence;
+	mIsHoldingFrame = true;
+
+	outPositions = (const FLinearColor*)GetPositions(mHeader, slot);
+	outColors = GetColors(mHeader, slot);
+	outPointCount = FMath::Min(slot->PointCount, mHeader->MaxPointsPerFrame);
+	outTimestamp = slot->Timestamp;
+	return true;
+}
+
+void FPointCloudSharedMemoryConsumer::SubmitFrame()
+{
+	if (!mIsHoldingFrame)
+		return;
+
+	mUploadFence.BeginFence();
+	mIsFrameInFlight = true;
+}
+
+void FPointCloudSharedMemoryConsumer::ReleaseFrame()
+{
+	if (mHeader)
+		mHeader->ReadSequence.store(mLastSequence, std::memory_order_release);
+
+	mIsHoldingFrame = false;
+	mIsFrameInFlight = false;
+}
@@ -0,0 +1,51 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+#include "RenderCommandFence.h"
+#include "PointCloudSharedMemoryLayout.h"
+
+/**
+ * Consumer side of the shared-memory point stream (see ThirdParty/PointCloudSharedMemory for the producer).
+ * Frames are used in place: the newest frame is held until the render thread has uploaded it, then its slot is handed back to the producer.
+ */
+class FPointCloudSharedMemoryConsumer
+{
+public:
+	~FPointCloudSharedMemoryConsumer() { Disconnect(); };
+
+	/** Opens the named segment created by the capture process. On Windows, globalNamespace has to match the producer's setting. */
+	bool Connect(const FString &segmentName, bool globalNamespace = false);
+	void Disconnect();
+	bool IsConnected() const { return mHeader != nullptr; };
+
+	/** The capacity of a frame, equals the point count of the texture the frames are laid out for. */
+	uint32 GetMaxPointsPerFrame() const { return mHeader ? mHeader->MaxPointsPerFrame : 0; };
+
+	/**
+	* Acquires the newest published frame. Returns false if there is no new frame or the previous one is still in flight.
+	* Older, unconsumed frames are skipped.
+	*/
+	bool AcquireLatestFrame(const FLinearColor* &outPositions, const uint8* &outColors, uint32 &outPointCount, double &outTimestamp);
+
+	/** Marks the acquired frame as submitted for upload. Its slot is released once the render thread passed this point. */
+	void SubmitFrame();
+
+	/** Number of frames the producer published that were never rendered. */
+	uint64 GetSkippedFrameCount() const { return mSkippedFrames; };
+
+private:
+	void ReleaseFrame();
+
+	FPlatformMemory::FSharedMemoryRegion* mRegion = nullptr;
+	PointCloudSharedMemory::SegmentHeader* mHeader = nullptr;
+	uint64 mLastSequence = 0;
+	uint64 mSkippedFrames = 0;
+	bool mIsHoldingFrame = false;
+	bool mIsFrameInFlight = false;
+	FRenderCommandFence mUploadFence;
+};
@@ -0,0 +1,253 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudSpatialIndex.h"
+#include "PointCloudSpatialSort.h"
+#include "PointCloudLayout.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** Returns the ray parameter where the ray enters the box or -1 if it misses it within maxDistance. */
+	float GetRayBoxEntry(const FBox &box, const FVector &origin, const FVector &direction, float maxDistance)
+	{
+		float tMin = 0.f;
+		float tMax = maxDistance;
+
+		for (int32 axis = 0; axis < 3; ++axis) {
+
+			if (FMath::Abs(direction[axis]) < SMALL_NUMBER) {
+				if (origin[axis] < box.Min[axis] || origin[axis] > box.Max[axis])
+					return -1.f;
+				continue;
+			}
+
+			const float invDir = 1.f / direction[axis];
+			float t1 = (box.Min[axis] - origin[axis]) * invDir;
+			float t2 = (box.Max[axis] - origin[axis]) * invDir;
+			if (t1 > t2) Swap(t1, t2);
+
+			tMin = FMath::Max(tMin, t1);
+			tMax = FMath::Min(tMax, t2);
+			if (tMin > tMax)
+				return -1.f;
+		}
+
+		return tMin;
+	}
+
+	struct FNeighbour
+	{
+		float DistSq;
+		int32 Batch;
+		int32 Slot;
+	};
+}
+
+void FPointCloudSpatialIndex::RemapIndices(const TArray<int32> &permutation)
+{
+	mInversePermutation.SetNumUninitialized(permutation.Num(), false);
+	ParallelFor(permutation.Num(), [&](int32 newIndex) {
+		mInversePermutation[permutation[newIndex]] = newIndex;
+	});
+
+	for (FBatch &batch : mBatches) {
+		ParallelFor(batch.Indices.Num(), [&](int32 i) {
+			batch.Indices[i] = mInversePermutation[batch.Indices[i]];
+		});
+	}
+}
+
+void FPointCloudSpatialIndex::AddBatch(const FLinearColor* pointPositions, int32 pointCount, int32 firstPointIndex)
+{
+	if (!pointPositions || pointCount <= 0)
+		return;
+
+	FBatch &batch = mBatches.AddDefaulted_GetRef();
+
+	// Morton order makes the leaves spatially compact
+	FPointCloudSpatialSorter sorter;
+	sorter.Sort(pointPositions, pointCount, FBox(ForceInit), EPointCloudSortOrder::Morton);
+	const TArray<int32> &permutation = sorter.GetPermutation();
+
+	batch.Positions.SetNumUninitialized(pointCount);
+	batch.Indices.SetNumUninitialized(pointCount);
+	ParallelFor(pointCount, [&](int32 i) {
+		batch.Positions[i] = PointCloudLayout::UnpackPosition(pointPositions[permutation[i]]);
+		batch.Indices[i] = firstPointIndex + permutation[i];
+	});
+
+	batch.LeafCount = FMath::DivideAndRoundUp(pointCount, LeafSize);
+	batch.FirstLeafNode = FMath::RoundUpToPowerOfTwo(batch.LeafCount);
+	batch.Nodes.Init(FBox(ForceInit), batch.FirstLeafNode * 2);
+
+	// Leaf bounds in parallel, then the inner nodes bottom-up
+	ParallelFor(batch.LeafCount, [&](int32 leaf) {
+		const int32 start = leaf * LeafSize;
+		const int32 end = FMath::Min(start + LeafSize, pointCount);
+		FBox &bounds = batch.Nodes[batch.FirstLeafNode + leaf];
+		for (int32 i = start; i < end; ++i)
+			bounds += batch.Positions[i];
+	});
+
+	for (int32 node = batch.FirstLeafNode - 1; node >= 1; --node)
+		batch.Nodes[node] = batch.Nodes[2 * node] + batch.Nodes[2 * node + 1];
+}
+
+template<typename NodeTest, typename PointVisitor>
+void FPointCloudSpatialIndex::Traverse(const FBatch &batch, NodeTest &&nodeTest, PointVisitor &&visitor) const
+{
+	// The node test returns the visiting priority (lower first) or a negative value to skip the node
+	auto testNode = [&](int32 node) { return batch.Nodes[node].IsValid ? nodeTest(batch.Nodes[node]) : -1.f; };
+
+	int32 stack[64];
+	int32 stackSize = 0;
+	if (testNode(1) >= 0.f)
+		stack[stackSize++] = 1;
+
+	while (stackSize > 0) {
+
+		const int32 node = stack[--stackSize];
+
+		// Test again, the query might have been narrowed down in the meantime
+		if (testNode(node) < 0.f)
+			continue;
+
+		if (node >= batch.FirstLeafNode) {
+			const int32 start = (node - batch.FirstLeafNode) * LeafSize;
+			const int32 end = FMath::Min(start + LeafSize, batch.Positions.Num());
+			for (int32 i = start; i < end; ++i)
+				visitor(i);
+			continue;
+		}
+
+		// Push the farther child first, so the nearer one is visited next
+		const int32 left = 2 * node;
+		const int32 right = left + 1;
+		const float leftKey = testNode(left);
+		const float rightKey = testNode(right);
+		if (leftKey >= 0.f && rightKey >= 0.f) {
+			stack[stackSize++] = leftKey <= rightKey ? right : left;
+			stack[stackSize++] = leftKey <= rightKey ? left : right;
+		}
+		else if (leftKey >= 0.f) {
+			stack[stackSize++] = left;
+		}
+		else if (rightKey >= 0.f) {
+			stack[stackSize++] = right;
+		}
+	}
+}
+
+bool FPointCloudSpatialIndex::Raycast(const FVector &origin, const FVector &direction, float maxDistance, float tolerance, int32 &outIndex, FVector &outPosition) const
+{
+	const FVector dir = direction.GetSafeNormal();
+	if (dir.IsZero())
+		return false;
+
+	const float toleranceSq = tolerance * tolerance;
+	float bestDistance = maxDistance;
+	bool hasHit = false;
+
+	for (const FBatch &batch : mBatches) {
+
+		Traverse(batch,
+			[&](const FBox &box) {
+				const float entry = GetRayBoxEntry(box.ExpandBy(tolerance), origin, dir, bestDistance);
+				return entry <= bestDistance ? entry : -1.f;
+			},
+			[&](int32 slot) {
+				const FVector toPoint = batch.Positions[slot] - origin;
+				const float t = FVector::DotProduct(toPoint, dir);
+				if (t < 0.f || t > bestDistance)
+					return;
+				if ((toPoint - dir * t).SizeSquared() > toleranceSq)
+					return;
+
+				bestDistance = t;
+				outIndex = batch.Indices[slot];
+				outPosition = batch.Positions[slot];
+				hasHit = true;
+			});
+	}
+
+	return hasHit;
+}
+
+void FPointCloudSpatialIndex::FindInRadius(const FVector &center, float radius, TArray<int32> &outIndices, TArray<FVector> &outPositions) const
+{
+	outIndices.Reset();
+	outPositions.Reset();
+	const float radiusSq = radius * radius;
+
+	for (const FBatch &batch : mBatches) {
+
+		Traverse(batch,
+			[&](const FBox &box) { return box.ComputeSquaredDistanceToPoint(center) <= radiusSq ? 0.f : -1.f; },
+			[&](int32 slot) {
+				if (FVector::DistSquared(batch.Positions[slot], center) <= radiusSq) {
+					outIndices.Add(batch.Indices[slot]);
+					outPositions.Add(batch.Positions[slot]);
+				}
+			});
+	}
+}
+
+void FPointCloudSpatialIndex::FindInBox(const FBox &box, TArray<int32> &outIndices, TArray<FVector> &outPositions) const
+{
+	outIndices.Reset();
+	outPositions.Reset();
+
+	for (const FBatch &batch : mBatches) {
+
+		Traverse(batch,
+			[&](const FBox &nodeBox) { return nodeBox.Intersect(box) ? 0.f : -1.f; },
+			[&](int32 slot) {
+				if (box.IsInsideOrOn(batch.Positions[slot])) {
+					outIndices.Add(batch.Indices[slot]);
+					outPositions.Add(batch.Positions[slot]);
+				}
+			});
+	}
+}
+
+void FPointCloudSpatialIndex::FindNearest(const FVector &center, int32 count, TArray<int32> &outIndices, TArray<FVector> &outPositions) const
+{
+	outIndices.Reset();
+	outPositions.Reset();
+	if (count <= 0)
+		return;
+
+	// Max-heap of the best candidates, the top is the current k-th nearest
+	auto heapPredicate = [](const FNeighbour &a, const FNeighbour &b) { return a.DistSq > b.DistSq; };
+	TArray<FNeighbour> heap;
+	heap.Reserve(count + 1);
+
+	for (int32 batchIndex = 0; batchIndex < mBatches.Num(); ++batchIndex) {
+
+		const FBatch &batch = mBatches[batchIndex];
+		Traverse(batch,
+			[&](const FBox &box) {
+				const float distSq = box.ComputeSquaredDistanceToPoint(center);
+				return heap.Num() < count || distSq < heap.HeapTop().DistSq ? distSq : -1.f;
+			},
+			[&](int32 slot) {
+				const float distSq = FVector::DistSquared(batch.Positions[slot], center);
+				if (heap.Num() < count) {
+					heap.HeapPush(FNeighbour{ distSq, batchIndex, slot }, heapPredicate);
+				}
+				else if (distSq < heap.HeapTop().DistSq) {
+					FNeighbour removed;
+					heap.HeapPop(removed, heapPredicate, false);
+					heap.HeapPush(FNeighbour{ distSq, batchIndex, slot }, heapPredicate);
+				}
+			});
+	}
+
+	heap.Sort([](const FNeighbour &a, const FNeighbour &b) { return a.DistSq < b.DistSq; });
+	for (const FNeighbour &neighbour : heap) {
+		outIndices.Add(mBatches[neighbour.Batch].Indices[neighbour.Slot]);
+		outPositions.Add(mBatches[neighbour.Batch].Positions[neighbour.Slot]);
+	}
+}
@@ -0,0 +1,60 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bounding volume hierarchy over the points of a streaming core for picking and neighbourhood queries.
+ * The points are added in batches (e.g. one per snapshot). Every batch is Morton-sorted and gets its own implicit, complete
+ * binary tree over leaves of LeafSize points, so appending points never touches the existing batches.
+ * All positions and results are in the local space of the core, results are indices into the core's point buffer.
+ */
+class FPointCloudSpatialIndex
+{
+public:
+	static const int32 LeafSize = 32;
+
+	void Reset() { mBatches.Reset(); };
+	bool IsEmpty() const { return mBatches.Num() == 0; };
+
+	/**
+	* Indexes the given points (packed position layout). Builds in parallel.
+	*
+	* @param	pointPositions				The packed point positions of the batch.
+	* @param	pointCount					The number of points in the batch.
+	* @param	firstPointIndex				The index of the first point in the core's point buffer.
+	*/
+	void AddBatch(const FLinearColor* pointPositions, int32 pointCount, int32 firstPointIndex);
+
+	/**
+	* Follows a reordering of the core's point buffer, the tree itself is unchanged as the points did not move.
+	* All indexed points have to be part of the permutation (permutation[newIndex] = oldIndex).
+	*/
+	void RemapIndices(const TArray<int32> &permutation);
+
+	/** Finds the first point along the ray that lies within the given distance to the ray. */
+	bool Raycast(const FVector &origin, const FVector &direction, float maxDistance, float tolerance, int32 &outIndex, FVector &outPosition) const;
+
+	void FindInRadius(const FVector &center, float radius, TArray<int32> &outIndices, TArray<FVector> &outPositions) const;
+	void FindInBox(const FBox &box, TArray<int32> &outIndices, TArray<FVector> &outPositions) const;
+	void FindNearest(const FVector &center, int32 count, TArray<int32> &outIndices, TArray<FVector> &outPositions) const;
+
+private:
+	struct FBatch
+	{
+		int32 LeafCount = 0;
+		int32 FirstLeafNode = 1;		// Power of two, node i has the children 2i and 2i+1, the root is node 1
+		TArray<FBox> Nodes;
+		TArray<FVector> Positions;		// In Morton order
+		TArray<int32> Indices;			// Core point index of every sorted position
+	};
+
+	template<typename NodeTest, typename PointVisitor>
+	void Traverse(const FBatch &batch, NodeTest &&nodeTest, PointVisitor &&visitor) const;
+
+	TArray<FBatch> mBatches;
+	TArray<int32> mInversePermutation;
+};
@@ -0,0 +1,161 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudSpatialSort.h"
+#include "PointCloudLayout.h"
+
+namespace
+{
+	const int32 ParallelChunkSize = 65536;
+	const int32 RadixBits = 11;
+	const int32 RadixSize = 1 << RadixBits;
+	const int32 RadixPasses = 6;	// 6 * 11 bits >= 63-bit keys
+}
+
+void FPointCloudSpatialSorter::Sort(const FLinearColor* pointPositions, int32 pointCount, FBox extent, EPointCloudSortOrder order)
+{
+	mKeys.SetNumUninitialized(FMath::Max(pointCount, 0), false);
+	mIndices.SetNumUninitialized(FMath::Max(pointCount, 0), false);
+	if (!pointPositions || pointCount <= 0)
+		return;
+
+	const int32 numChunks = FMath::DivideAndRoundUp(pointCount, ParallelChunkSize);
+
+	// Fall back to the bounds of the points if no extent has been set
+	if (!extent.IsValid || extent.GetVolume() <= 0.f) {
+
+		mChunkBounds.SetNumUninitialized(numChunks, false);
+		ParallelFor(numChunks, [&](int32 chunk) {
+
+			const int32 start = chunk * ParallelChunkSize;
+			const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+			FVector minPos(BIG_NUMBER), maxPos(-BIG_NUMBER);
+
+			for (int32 i = start; i < end; ++i) {
+				const FVector pos = PointCloudLayout::UnpackPosition(pointPositions[i]);
+				minPos = minPos.ComponentMin(pos);
+				maxPos = maxPos.ComponentMax(pos);
+			}
+			mChunkBounds[chunk] = FBox(minPos, maxPos);
+		});
+
+		extent = FBox(ForceInit);
+		for (const FBox &chunkBox : mChunkBounds)
+			extent += chunkBox;
+	}
+
+	const FVector extentMin = extent.Min;
+	const FVector quantization = FVector((float)PointCloudSpatialSort::MaxAxisValue) / extent.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+
+	// Quantize the positions and compute the curve keys
+	ParallelFor(numChunks, [&](int32 chunk) {
+
+		const int32 start = chunk * ParallelChunkSize;
+		const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+		const float maxValue = (float)PointCloudSpatialSort::MaxAxisValue;
+
+		for (int32 i = start; i < end; ++i) {
+			const FVector local = (PointCloudLayout::UnpackPosition(pointPositions[i]) - extentMin) * quantization;
+			const uint32 x = (uint32)FMath::Clamp(local.X, 0.f, maxValue);
+			const uint32 y = (uint32)FMath::Clamp(local.Y, 0.f, maxValue);
+			const uint32 z = (uint32)FMath::Clamp(local.Z, 0.f, maxValue);
+
+			mKeys[i] = order == EPointCloudSortOrder::Hilbert ? PointCloudSpatialSort::EncodeHilbert(x, y, z) : PointCloudSpatialSort::EncodeMorton(x, y, z);
+			mIndices[i] = i;
+		}
+	});
+
+	RadixSort();
+}
+
+void FPointCloudSpatialSorter::RadixSort()
+{
+	const int32 pointCount = mKeys.Num();
+	const int32 numChunks = FMath::DivideAndRoundUp(pointCount, ParallelChunkSize);
+
+	mKeysTemp.SetNumUninitialized(pointCount, false);
+	mIndicesTemp.SetNumUninitialized(pointCount, false);
+	mHistograms.SetNumUninitialized(numChunks * RadixSize, false);
+
+	for (int32 pass = 0; pass < RadixPasses; ++pass) {
+
+		const int32 shift = pass * RadixBits;
+
+		// Per-chunk digit histograms
+		ParallelFor(numChunks, [&](int32 chunk) {
+
+			const int32 start = chunk * ParallelChunkSize;
+			const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+			int32* histogram = &mHistograms[chunk * RadixSize];
+			FMemory::Memzero(histogram, RadixSize * sizeof(int32));
+
+			for (int32 i = start; i < end; ++i)
+				histogram[(mKeys[i] >> shift) & (RadixSize - 1)]++;
+		});
+
+		// Exclusive prefix sum in digit-major, chunk-minor order keeps the sort stable.
+		// Passes where all keys share the same digit are skipped.
+		bool isTrivialPass = false;
+		int32 offset = 0;
+		for (int32 digit = 0; digit < RadixSize; ++digit) {
+
+			int32 digitCount = 0;
+			for (int32 chunk = 0; chunk < numChunks; ++chunk) {
+				int32 &entry = mHistograms[chunk * RadixSize + digit];
+				const int32 count = entry;
+				entry = offset;
+				offset += count;
+				digitCount += count;
+			}
+			if (digitCount == pointCount) {
+				isTrivialPass = true;
+				break;
+			}
+		}
+		if (isTrivialPass)
+			continue;
+
+		// Stable scatter
+		ParallelFor(numChunks, [&](int32 chunk) {
+
+			const int32 start = chunk * ParallelChunkSize;
+			const int32 end = FMath::Min(start + ParallelChunkSize, pointCount);
+			int32* histogram = &mHistograms[chunk * RadixSize];
+
+			for (int32 i = start; i < end; ++i) {
+				const int32 target = histogram[(mKeys[i] >> shift) & (RadixSize - 1)]++;
+				mKeysTemp[target] = mKeys[i];
+				mIndicesTemp[target] = mIndices[i];
+			}
+		});
+
+		Swap(mKeys, mKeysTemp);
+		Swap(mIndices, mIndicesTemp);
+	}
+}
+
+void FPointCloudSpatialSorter::InterleavePermutation()
+{
+	const int32 pointCount = mIndices.Num();
+	if (pointCount <= 2)
+		return;
+
+	const uint32 bits = FMath::CeilLogTwo((uint32)pointCount);
+	const uint32 paddedCount = 1u << bits;
+
+	mIndicesTemp.SetNumUninitialized(pointCount, false);
+	mKeysTemp.SetNumUninitialized(pointCount, false);
+	int32 target = 0;
+	for (uint32 i = 0; i < paddedCount; ++i) {
+		const uint32 source = ReverseBits(i) >> (32 - bits);
+		if (source < (uint32)pointCount) {
+			mIndicesTemp[target] = mIndices[source];
+			mKeysTemp[target] = mKeys[source];
+			target++;
+		}
+	}
+
+	Swap(mKeys, mKeysTemp);
+	Swap(mIndices, mIndicesTemp);
+}
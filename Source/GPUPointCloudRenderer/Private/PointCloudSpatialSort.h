@@ -0,0 +1,143 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PointCloudStreamingCore.h"
+#include "Async/ParallelFor.h"
+
+/**
+ * Space-filling curve keys with 21 bits per axis (63-bit keys).
+ */
+namespace PointCloudSpatialSort
+{
+	const uint32 BitsPerAxis = 21;
+	const uint32 MaxAxisValue = (1u << BitsPerAxis) - 1;
+
+	/** Spreads the lower 21 bits of v, so that there are two zero bits between every bit. */
+	FORCEINLINE uint64 SplitBy3(uint32 v)
+	{
+		uint64 x = v & 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+
+	FORCEINLINE uint64 EncodeMorton(uint32 x, uint32 y, uint32 z)
+	{
+		return SplitBy3(x) | (SplitBy3(y) << 1) | (SplitBy3(z) << 2);
+	}
+
+	/** Inverse of SplitBy3(). */
+	FORCEINLINE uint32 CompactBy3(uint64 x)
+	{
+		x &= 0x1249249249249249ull;
+		x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+		x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+		x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+		x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+		x = (x ^ (x >> 32)) & 0x1fffff;
+		return (uint32)x;
+	}
+
+	FORCEINLINE void DecodeMorton(uint64 key, uint32 &outX, uint32 &outY, uint32 &outZ)
+	{
+		outX = CompactBy3(key);
+		outY = CompactBy3(key >> 1);
+		outZ = CompactBy3(key >> 2);
+	}
+
+	/** Hilbert index after Skilling ("Programming the Hilbert curve", 2004). */
+	FORCEINLINE uint64 EncodeHilbert(uint32 x, uint32 y, uint32 z)
+	{
+		uint32 axes[3] = { x, y, z };
+		const uint32 highestBit = 1u << (BitsPerAxis - 1);
+
+		// Inverse undo
+		for (uint32 q = highestBit; q > 1; q >>= 1) {
+			const uint32 p = q - 1;
+			for (int32 i = 0; i < 3; ++i) {
+				if (axes[i] & q) {
+					axes[0] ^= p;
+				}
+				else {
+					const uint32 t = (axes[0] ^ axes[i]) & p;
+					axes[0] ^= t;
+					axes[i] ^= t;
+				}
+			}
+		}
+
+		// Gray encode
+		axes[1] ^= axes[0];
+		axes[2] ^= axes[1];
+		uint32 t = 0;
+		for (uint32 q = highestBit; q > 1; q >>= 1)
+			if (axes[2] & q) t ^= q - 1;
+		for (int32 i = 0; i < 3; ++i)
+			axes[i] ^= t;
+
+		// The transposed index is read MSB-first in the order axes[0], axes[1], axes[2]
+		return EncodeMorton(axes[2], axes[1], axes[0]);
+	}
+}
+
+/**
+ * Reorders points along a Morton or Hilbert curve with a parallel LSD radix sort.
+ * Sorting is done on keys + indices only, the resulting permutation is then applied to all point buffers.
+ */
+class FPointCloudSpatialSorter
+{
+public:
+	/**
+	* Computes the curve keys of the given points and sorts them.
+	*
+	* @param	pointPositions				The packed point positions.
+	* @param	pointCount					The number of points to sort.
+	* @param	extent						The quantization domain. If invalid or empty, the bounds of the points are used.
+	* @param	order						The space-filling curve to sort along.
+	*/
+	void Sort(const FLinearColor* pointPositions, int32 pointCount, FBox extent, EPointCloudSortOrder order);
+
+	/**
+	* Reorders the sorted permutation in bit-reversal order of the curve positions, so that every prefix of the result
+	* is a spatially uniform subsample of the points (used for progressive loading).
+	*/
+	void InterleavePermutation();
+
+	/** The sorted permutation: GetPermutation()[newIndex] = oldIndex. */
+	const TArray<int32>& GetPermutation() const { return mIndices; };
+
+	/** The sorted keys. */
+	const TArray<uint64>& GetKeys() const { return mKeys; };
+
+	/** Applies the last computed permutation to the given buffer in place. */
+	template<typename T>
+	void ApplyPermutation(T* data, TArray<T> &scratch) const
+	{
+		const int32 pointCount = mIndices.Num();
+		scratch.SetNumUninitialized(pointCount, false);
+		ParallelFor(FMath::DivideAndRoundUp(pointCount, 16384), [&](int32 chunk) {
+			const int32 start = chunk * 16384;
+			const int32 end = FMath::Min(start + 16384, pointCount);
+			for (int32 i = start; i < end; ++i)
+				scratch[i] = data[mIndices[i]];
+		});
+		FMemory::Memcpy(data, scratch.GetData(), pointCount * sizeof(T));
+	}
+
+private:
+	void RadixSort();
+
+	TArray<uint64> mKeys;
+	TArray<uint64> mKeysTemp;
+	TArray<int32> mIndices;
+	TArray<int32> mIndicesTemp;
+	TArray<int32> mHistograms;
+	TArray<FBox> mChunkBounds;
+};
@@ -0,0 +1,616 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#include "PointCloudStreamRecorder.h"
+#include "PointCloudStreamingCore.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPointCloudStream, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Record Point Stream"), STAT_RecordPointStream, STATGROUP_GPUPCR);
+DECLARE_MEMORY_STAT(TEXT("Recorded Stream Bytes"), STAT_RecordedStreamBytes, STATGROUP_GPUPCR);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dropped Stream Records"), STAT_DroppedStreamRecords, STATGROUP_GPUPCR);
+
+namespace PointCloudStream
+{
+	const uint32 FileMagic = 0x53524350;	// "PCRS"
+	const uint32 FileVersion = 1;
+
+	enum ERecordType : uint8
+	{
+		InputLinearColorBytes,
+		InputLinearColorColors,
+		InputVectorColors,
+		Snapshot,
+		BatchedSnapshot,		// One snapshot of an AddSnapshots call
+		RegisterSource,			// PointCount is the maximum point count of the source
+		ClearSources,
+		SourceLinearColorBytes,
+		SourceVectorColors
+	};
+
+	enum ERecordFlags : uint8
+	{
+		LastInBatch = 1
+	};
+
+	struct FRecordHeader
+	{
+		double Timestamp;
+		int32 PointCount;
+		int32 PositionBytes;
+		int32 ColorBytes;
+		uint8 Type;
+		uint8 Flags;
+		int16 SourceId;		// Source records only
+		float Translation[3];
+		float Rotation[3];
+	};
+
+	struct FChunkHeader
+	{
+		int32 UncompressedSize;
+		int32 CompressedSize;	// Equals UncompressedSize if the chunk is stored uncompressed
+		int32 RecordCount;
+	};
+
+	// zlib cannot expand data by more than this factor
+	const int64 MaxCompressionRatio = 1032;
+}
+
+using namespace PointCloudStream;
+
+//////////////////////
+// RECORDER //////////
+//////////////////////
+
+FPointCloudStreamRecorder::~FPointCloudStreamRecorder()
+{
+	Close();
+
+	FChunk* chunk = nullptr;
+	while (mFreeChunks.Dequeue(chunk))
+		delete chunk;
+}
+
+bool FPointCloudStreamRecorder::Open(const FString &filePath, int32 chunkSize, int32 maxPendingChunks)
+{
+	Close();
+
+	mWriter = IFileManager::Get().CreateFileWriter(*filePath);
+	if (!mWriter)
+		return false;
+
+	uint32 magic = FileMagic;
+	uint32 version = FileVersion;
+	*mWriter << magic;
+	*mWriter << version;
+
+	mChunkSize = FMath::Max(chunkSize, 64 * 1024);
+	mMaxPendingChunks = FMath::Max(maxPendingChunks, 1);
+	mStartTime = 0.0;
+	mRecordedBytes = 0;
+	mWrittenBytes = 0;
+	mDroppedRecords = 0;
+	mStopRequested = false;
+
+	if (!mCurrentChunk && !mFreeChunks.Dequeue(mCurrentChunk))
+		mCurrentChunk = new FChunk();
+	mCurrentChunk->Data.Reset();
+	mCurrentChunk->Data.Reserve(mChunkSize);
+	mCurrentChunk->RecordCount = 0;
+
+	mWorkEvent = FPlatformProcess::GetSynchEventFromPool();
+	mWriterThread = FRunnableThread::Create(this, TEXT("PointCloudStreamRecorder"), 0, TPri_BelowNormal);
+	return mWriterThread != nullptr;
+}
+
+void FPointCloudStreamRecorder::Close()
+{
+	if (mWriterThread) {
+		FlushChunk();
+		Stop();
+		mWorkEvent->Trigger();
+		mWriterThread->WaitForCompletion();
+		delete mWriterThread;
+		mWriterThread = nullptr;
+
+		if (mDroppedRecords > 0)
+			UE_LOG(LogPointCloudStream, Warning, TEXT("%lld records were dropped from the recording, the disk could not keep up."), mDroppedRecords);
+	}
+
+	if (mWorkEvent) {
+		FPlatformProcess::ReturnSynchEventToPool(mWorkEvent);
+		mWorkEvent = nullptr;
+	}
+
+	if (mWriter) {
+		mWriter->Close();
+		delete mWriter;
+		mWriter = nullptr;
+	}
+
+	if (mCurrentChunk) delete mCurrentChunk; mCurrentChunk = nullptr;
+}
+
+void FPointCloudStreamRecorder::RecordInput(const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors, int32 pointCount)
+{
+	pointCount = FMath::Min3(pointCount, pointPositions.Num(), pointColors.Num() / 4);
+	AppendRecord(InputLinearColorBytes, pointPositions.GetData(), pointCount * sizeof(FLinearColor), pointColors.GetData(), pointCount * 4, pointCount, FVector::ZeroVector, FRotator::ZeroRotator);
+}
+
+void FPointCloudStreamRecorder::RecordInput(const TArray<FLinearColor> &pointPositions, const TArray<FColor> &pointColors)
+{
+	AppendRecord(InputLinearColorColors, pointPositions.GetData(), pointPositions.Num() * sizeof(FLinearColor), pointColors.GetData(), pointColors.Num() * sizeof(FColor), pointPositions.Num(), FVector::ZeroVector, FRotator::ZeroRotator);
+}
+
+void FPointCloudStreamRecorder::RecordInput(const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors)
+{
+	AppendRecord(InputVectorColors, pointPositions.GetData(), pointPositions.Num() * sizeof(FVector), pointColors.GetData(), pointColors.Num() * sizeof(FColor), pointPositions.Num(), FVector::ZeroVector, FRotator::ZeroRotator);
+}
+
+void FPointCloudStreamRecorder::RecordSnapshot(const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors, FVector offsetTranslation, FRotator offsetRotation)
+{
+	AppendRecord(Snapshot, pointPositions.GetData(), pointPositions.Num() * sizeof(FLinearColor), pointColors.GetData(), pointColors.Num(), pointPositions.Num(), offsetTranslation, offsetRotation);
+}
+
+void FPointCloudStreamRecorder::RecordSnapshots(const TArray<FPointCloudSnapshot> &snapshots)
+{
+	int32 lastSnapshot = snapshots.Num() - 1;
+	while (lastSnapshot >= 0 && (!snapshots[lastSnapshot].PointPositions || !snapshots[lastSnapshot].PointColors))
+		lastSnapshot--;
+
+	for (int32 s = 0; s <= lastSnapshot; ++s) {
+		const FPointCloudSnapshot &snapshot = snapshots[s];
+		if (!snapshot.PointPositions || !snapshot.PointColors)
+			continue;
+		const TArray<FLinearColor> &positions = *snapshot.PointPositions;
+		const TArray<uint8> &colors = *snapshot.PointColors;
+		AppendRecord(BatchedSnapshot, positions.GetData(), positions.Num() * sizeof(FLinearColor), colors.GetData(), colors.Num(), positions.Num(),
+			snapshot.OffsetTranslation, snapshot.OffsetRotation, s == lastSnapshot ? LastInBatch : 0);
+	}
+}
+
+void FPointCloudStreamRecorder::RecordRegisterSource(int32 sourceId, int32 maxPointCount)
+{
+	AppendRecord(RegisterSource, nullptr, 0, nullptr, 0, maxPointCount, FVector::ZeroVector, FRotator::ZeroRotator, 0, sourceId);
+}
+
+void FPointCloudStreamRecorder::RecordClearSources()
+{
+	AppendRecord(ClearSources, nullptr, 0, nullptr, 0, 0, FVector::ZeroVector, FRotator::ZeroRotator);
+}
+
+void FPointCloudStreamRecorder::RecordSourceUpdate(int32 sourceId, const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors)
+{
+	const int32 pointCount = FMath::Min(pointPositions.Num(), pointColors.Num() / 4);
+	AppendRecord(SourceLinearColorBytes, pointPositions.GetData(), pointCount * sizeof(FLinearColor), pointColors.GetData(), pointCount * 4, pointCount, FVector::ZeroVector, FRotator::ZeroRotator, 0, sourceId);
+}
+
+void FPointCloudStreamRecorder::RecordSourceUpdate(int32 sourceId, const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors)
+{
+	const int32 pointCount = FMath::Min(pointPositions.Num(), pointColors.Num());
+	AppendRecord(SourceVectorColors, pointPositions.GetData(), pointCount * sizeof(FVector), pointColors.GetData(), pointCount * sizeof(FColor), pointCount, FVector::ZeroVector, FRotator::ZeroRotator, 0, sourceId);
+}
+
+void FPointCloudStreamRecorder::AppendRecord(uint8 type, const void* positions, int32 positionBytes, const void* colors, int32 colorBytes, int32 pointCount, const FVector &translation, const FRotator &rotation, uint8 flags, int32 sourceId)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RecordPointStream);
+
+	if (!mWriterThread || !mCurrentChunk)
+		return;
+
+	// The stream starts with the first record
+	if (mRecordedBytes == 0)
+		mStartTime = FPlatformTime::Seconds();
+
+	FRecordHeader header;
+	FMemory::Memzero(header);
+	header.Timestamp = FPlatformTime::Seconds() - mStartTime;
+	header.PointCount = pointCount;
+	header.PositionBytes = positionBytes;
+	header.ColorBytes = colorBytes;
+	header.Type = type;
+	header.Flags = flags;
+	header.SourceId = (int16)sourceId;
+	header.Translation[0] = translation.X;
+	header.Translation[1] = translation.Y;
+	header.Translation[2] = translation.Z;
+	header.Rotation[0] = rotation.Pitch;
+	header.Rotation[1] = rotation.Yaw;
+	header.Rotation[2] = rotation.Roll;
+
+	const int32 recordSize = sizeof(FRecordHeader) + positionBytes + colorBytes;
+	if (mCurrentChunk->RecordCount > 0 && mCurrentChunk->Data.Num() + recordSize > mChunkSize) {
+		// The writer thread is behind, the record is dropped instead of queueing ever more memory
+		if (mPendingChunkCount.GetValue() >= mMaxPendingChunks) {
+			mDroppedRecords++;
+			INC_DWORD_STAT(STAT_DroppedStreamRecords);
+			return;
+		}
+		FlushChunk();
+	}
+
+	// Only copy here, compression happens on the writer thread
+	const int32 offset = mCurrentChunk->Data.AddUninitialized(recordSize);
+	uint8* target = mCurrentChunk->Data.GetData() + offset;
+	FMemory::Memcpy(target, &header, sizeof(FRecordHeader));
+	FMemory::Memcpy(target + sizeof(FRecordHeader), positions, positionBytes);
+	FMemory::Memcpy(target + sizeof(FRecordHeader) + positionBytes, colors, colorBytes);
+	mCurrentChunk->RecordCount++;
+
+	mRecordedBytes += recordSize;
+	SET_MEMORY_STAT(STAT_RecordedStreamBytes, mRecordedBytes);
+}
+
+void FPointCloudStreamRecorder::FlushChunk()
+{
+	if (!mCurrentChunk || mCurrentChunk->RecordCount == 0)
+		return;
+
+	mPendingChunks.Enqueue(mCurrentChunk);
+	mPendingChunkCount.Increment();
+	mWorkEvent->Trigger();
+
+	// Recycle the buffers the writer thread is done with
+	if (!mFreeChunks.Dequeue(mCurrentChunk)) {
+		mCurrentChunk = new FChunk();
+		mCurrentChunk->Data.Reserve(mChunkSize);
+	}
+	mCurrentChunk->Data.Reset();
+	mCurrentChunk->RecordCount = 0;
+}
+
+uint32 FPointCloudStreamRecorder::Run()
+{
+	for (;;) {
+
+		FChunk* chunk = nullptr;
+		if (mPendingChunks.Dequeue(chunk)) {
+			WriteChunk(chunk);
+			mFreeChunks.Enqueue(chunk);
+			mPendingChunkCount.Decrement();
+			continue;
+		}
+
+		if (mStopRequested)
+			break;
+
+		mWorkEvent->Wait(100);
+	}
+
+	return 0;
+}
+
+void FPointCloudStreamRecorder::WriteChunk(FChunk* chunk)
+{
+	FChunkHeader header;
+	header.UncompressedSize = chunk->Data.Num();
+	header.RecordCount = chunk->RecordCount;
+
+	int32 compressedSize = FCompression::CompressMemoryBound(NAME_Zlib, header.UncompressedSize);
+	mCompressionBuffer.SetNumUninitialized(compressedSize, false);
+
+	const uint8* payload = mCompressionBuffer.GetData();
+	if (!FCompression::CompressMemory(NAME_Zlib, mCompressionBuffer.GetData(), compressedSize, chunk->Data.GetData(), header.UncompressedSize, COMPRESS_BiasSpeed) || compressedSize >= header.UncompressedSize) {
+		compressedSize = header.UncompressedSize;
+		payload = chunk->Data.GetData();
+	}
+	header.CompressedSize = compressedSize;
+
+	mWriter->Serialize(&header, sizeof(FChunkHeader));
+	mWriter->Serialize((void*)payload, compressedSize);
+	mWrittenBytes += sizeof(FChunkHeader) + compressedSize;
+}
+
+//////////////////////
+// REPLAYER //////////
+//////////////////////
+
+FString FPointCloudReplayStats::ToString() const
+{
+	return FString::Printf(TEXT("%d calls, %lld points, stream %.2fs, replay %.2fs, decode %.2fs, ingest %.2fs (%.2f M points/s), latency avg %.3fms / min %.3fms / max %.3fms"),
+		CallCount, PointCount, StreamDuration, ReplayDuration, DecodeSeconds, IngestSeconds, GetPointsPerSecond() / 1e6,
+		GetAverageLatency() * 1000.0, MinLatency * 1000.0, MaxLatency * 1000.0);
+}
+
+bool FPointCloudStreamReplayer::Open(const FString &filePath)
+{
+	Close();
+
+	mReader = IFileManager::Get().CreateFileReader(*filePath);
+	if (!mReader)
+		return false;
+
+	uint32 magic = 0, version = 0;
+	*mReader << magic;
+	*mReader << version;
+	if (magic != FileMagic || version != FileVersion) {
+		UE_LOG(LogPointCloudStream, Error, TEXT("%s is not a point stream recording (or has an unsupported version)."), *filePath);
+		Close();
+		return false;
+	}
+
+	mChunkOffset = 0;
+	mChunkRecordsLeft = 0;
+	mBatchSnapshots.Reset();
+	mBatchPointCount = 0;
+	mSourceIds.Reset();
+	mStats = FPointCloudReplayStats();
+	return true;
+}
+
+void FPointCloudStreamReplayer::Close()
+{
+	if (mReader) {
+		mReader->Close();
+		delete mReader;
+		mReader = nullptr;
+	}
+	mChunkData.Reset();
+	mChunkRecordsLeft = 0;
+}
+
+bool FPointCloudStreamReplayer::ReadNextChunk()
+{
+	if (!mReader || mReader->AtEnd())
+		return false;
+
+	FChunkHeader header;
+	mReader->Serialize(&header, sizeof(FChunkHeader));
+	if (mReader->IsError() || header.UncompressedSize <= 0 || header.CompressedSize <= 0 || header.RecordCount <= 0)
+		return false;
+
+	// The sizes are checked against the rest of the file before anything is allocated
+	const int64 remainingBytes = mReader->TotalSize() - mReader->Tell();
+	if (header.CompressedSize > remainingBytes || header.CompressedSize > header.UncompressedSize
+		|| header.UncompressedSize > header.CompressedSize * MaxCompressionRatio
+		|| header.RecordCount > header.UncompressedSize / (int32)sizeof(FRecordHeader)) {
+		UE_LOG(LogPointCloudStream, Error, TEXT("Corrupt chunk in point stream recording, the replay is stopped."));
+		return false;
+	}
+
+	mChunkData.SetNumUninitialized(header.UncompressedSize, false);
+	if (header.CompressedSize == header.UncompressedSize) {
+		mReader->Serialize(mChunkData.GetData(), header.UncompressedSize);
+	}
+	else {
+		mCompressedData.SetNumUninitialized(header.CompressedSize, false);
+		mReader->Serialize(mCompressedData.GetData(), header.CompressedSize);
+		if (!FCompression::UncompressMemory(NAME_Zlib, mChunkData.GetData(), header.UncompressedSize, mCompressedData.GetData(), header.CompressedSize))
+			return false;
+	}
+
+	mChunkOffset = 0;
+	mChunkRecordsLeft = header.RecordCount;
+	return !mReader->IsError();
+}
+
+/** Reads the header of the record at the given offset. Fails if the header or its announced payload exceed the chunk. */
+static bool ReadRecordHeader(const TArray<uint8> &chunkData, int32 offset, FRecordHeader &outHeader)
+{
+	if (offset < 0 || (int64)offset + (int64)sizeof(FRecordHeader) > chunkData.Num())
+		return false;
+
+	FMemory::Memcpy(&outHeader, chunkData.GetData() + offset, sizeof(FRecordHeader));
+	const int64 remainingBytes = chunkData.Num() - offset - (int64)sizeof(FRecordHeader);
+	return outHeader.PointCount >= 0 && outHeader.PositionBytes >= 0 && outHeader.ColorBytes >= 0 && (int64)outHeader.PositionBytes + outHeader.ColorBytes <= remainingBytes;
+}
+
+bool FPointCloudStreamReplayer::PeekNextTimestamp(double &outTimestamp)
+{
+	if (mChunkRecordsLeft == 0 && !ReadNextChunk())
+		return false;
+
+	FRecordHeader header;
+	if (!ReadRecordHeader(mChunkData, mChunkOffset, header))
+		return false;
+	outTimestamp = header.Timestamp;
+	return true;
+}
+
+bool FPointCloudStreamReplayer::ReplayNextRecord(FPointCloudStreamingCore &core, FPointCloudReplayStats &stats)
+{
+	const double decodeStart = FPlatformTime::Seconds();
+	if (mChunkRecordsLeft == 0 && !ReadNextChunk())
+		return false;
+
+	FRecordHeader header;
+	if (!ReadRecordHeader(mChunkData, mChunkOffset, header)) {
+		UE_LOG(LogPointCloudStream, Error, TEXT("Corrupt record in point stream recording, the replay is stopped."));
+		return false;
+	}
+	const uint8* positions = mChunkData.GetData() + mChunkOffset + sizeof(FRecordHeader);
+	const uint8* colors = positions + header.PositionBytes;
+	mChunkOffset += sizeof(FRecordHeader) + header.PositionBytes + header.ColorBytes;
+	mChunkRecordsLeft--;
+
+	// Copy the record into the array types of the matching ingest call. Incomplete trailing elements are dropped
+	auto copyInto = [](auto &target, const uint8* source, int32 bytes) {
+		const int32 count = bytes / target.GetTypeSize();
+		target.SetNumUninitialized(count, false);
+		FMemory::Memcpy(target.GetData(), source, count * target.GetTypeSize());
+	};
+
+	switch (header.Type) {
+	case InputVectorColors:
+	case SourceVectorColors:
+		copyInto(mVectorPositions, positions, header.PositionBytes);
+		copyInto(mFColors, colors, header.ColorBytes);
+		break;
+	case RegisterSource:
+	case ClearSources:
+		break;
+	case BatchedSnapshot: {
+		// The arrays of the batch are kept, so a replayed batch does not allocate once they have grown
+		const int32 s = mBatchSnapshots.Num();
+		if (s == mBatchPositions.Num()) {
+			mBatchPositions.AddDefaulted();
+			mBatchColors.AddDefaulted();
+		}
+		copyInto(mBatchPositions[s], positions, header.PositionBytes);
+		copyInto(mBatchColors[s], colors, header.ColorBytes);
+		FPointCloudSnapshot &snapshot = mBatchSnapshots.AddDefaulted_GetRef();
+		snapshot.OffsetTranslation = FVector(header.Translation[0], header.Translation[1], header.Translation[2]);
+		snapshot.OffsetRotation = FRotator(header.Rotation[0], header.Rotation[1], header.Rotation[2]);
+		mBatchPointCount += header.PointCount;
+		if (!(header.Flags & LastInBatch)) {
+			stats.DecodeSeconds += FPlatformTime::Seconds() - decodeStart;
+			return true;
+		}
+		break;
+	}
+	case InputLinearColorColors:
+		copyInto(mPositions, positions, header.PositionBytes);
+		copyInto(mFColors, colors, header.ColorBytes);
+		break;
+	default:
+		copyInto(mPositions, positions, header.PositionBytes);
+		copyInto(mColors, colors, header.ColorBytes);
+		break;
+	}
+	stats.DecodeSeconds += FPlatformTime::Seconds() - decodeStart;
+
+	const double ingestStart = FPlatformTime::Seconds();
+	switch (header.Type) {
+	case InputLinearColorBytes:
+		core.SetInput(mPositions, mColors);
+		break;
+	case InputLinearColorColors:
+		core.SetInput(mPositions, mFColors);
+		break;
+	case InputVectorColors:
+		core.SetInput(mVectorPositions, mFColors);
+		break;
+	case Snapshot: {
+		// Recorded snapshots already passed the capture step gate
+		const float captureSteps = core.mStreamCaptureSteps;
+		core.mStreamCaptureSteps = 0.f;
+		core.AddSnapshot(mPositions, mColors, FVector(header.Translation[0], header.Translation[1], header.Translation[2]), FRotator(header.Rotation[0], header.Rotation[1], header.Rotation[2]));
+		core.mStreamCaptureSteps = captureSteps;
+		break;
+	}
+	case BatchedSnapshot: {
+		// The array pointers are only taken now, as the batch arrays may have been reallocated while it was collected
+		for (int32 s = 0; s < mBatchSnapshots.Num(); ++s) {
+			mBatchSnapshots[s].PointPositions = &mBatchPositions[s];
+			mBatchSnapshots[s].PointColors = &mBatchColors[s];
+		}
+		core.AddSnapshots(mBatchSnapshots);
+		break;
+	}
+	case RegisterSource:
+		if (header.SourceId < 0)
+			return false;
+		if (header.SourceId >= mSourceIds.Num())
+			mSourceIds.Init(INDEX_NONE, header.SourceId + 1);
+		mSourceIds[header.SourceId] = core.RegisterSource(header.PointCount);
+		break;
+	case ClearSources:
+		core.ClearSources();
+		mSourceIds.Reset();
+		break;
+	case SourceLinearColorBytes:
+	case SourceVectorColors: {
+		// Updates of sources the replaying core could not register are skipped
+		const int32 sourceId = mSourceIds.IsValidIndex(header.SourceId) ? mSourceIds[header.SourceId] : INDEX_NONE;
+		if (sourceId != INDEX_NONE) {
+			if (header.Type == SourceLinearColorBytes)
+				core.UpdateSource(sourceId, mPositions, mColors);
+			else
+				core.UpdateSource(sourceId, mVectorPositions, mFColors);
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+	const double latency = FPlatformTime::Seconds() - ingestStart;
+
+	stats.MinLatency = stats.CallCount == 0 ? latency : FMath::Min(stats.MinLatency, latency);
+	stats.MaxLatency = FMath::Max(stats.MaxLatency, latency);
+	stats.IngestSeconds += latency;
+	if (header.Type == BatchedSnapshot)
+		stats.PointCount += mBatchPointCount;
+	else if (header.Type != RegisterSource)
+		stats.PointCount += header.PointCount;
+	if (header.Type == BatchedSnapshot) {
+		mBatchSnapshots.Reset();
+		mBatchPointCount = 0;
+	}
+	stats.StreamDuration = header.Timestamp;
+	stats.CallCount++;
+	return true;
+}
+
+bool FPointCloudStreamReplayer::ReplayAll(FPointCloudStreamingCore &core, bool realTime, FPointCloudReplayStats &outStats)
+{
+	if (!mReader)
+		return false;
+
+	outStats = FPointCloudReplayStats();
+	const double startTime = FPlatformTime::Seconds();
+
+	double timestamp = 0.0;
+	while (PeekNextTimestamp(timestamp)) {
+
+		if (realTime) {
+			const double waitTime = startTime + timestamp - FPlatformTime::Seconds();
+			if (waitTime > 0.0)
+				FPlatformProcess::Sleep((float)waitTime);
+		}
+
+		if (!ReplayNextRecord(core, outStats))
+			break;
+	}
+
+	outStats.ReplayDuration = FPlatformTime::Seconds() - startTime;
+	return outStats.CallCount > 0;
+}
+
+bool FPointCloudStreamReplayer::ReplayUntil(FPointCloudStreamingCore &core, double playbackTime)
+{
+	double timestamp = 0.0;
+	while (PeekNextTimestamp(timestamp)) {
+
+		if (timestamp > playbackTime)
+			return true;
+		if (!ReplayNextRecord(core, mStats))
+			return false;
+	}
+
+	return false;
+}
+
+//////////////////////
+// CONSOLE ///////////
+//////////////////////
+
+static void ReplayPointStreamCommand(const TArray<FString> &args)
+{
+	if (args.Num() < 1) {
+		UE_LOG(LogPointCloudStream, Warning, TEXT("Usage: PointCloud.Replay <file> [realtime]"));
+		return;
+	}
+
+	FPointCloudStreamReplayer replayer;
+	if (!replayer.Open(args[0]))
+		return;
+
+	FPointCloudStreamingCore core;
+	FPointCloudReplayStats stats;
+	replayer.ReplayAll(core, args.Num() > 1 && args[1].Equals(TEXT("realtime"), ESearchCase::IgnoreCase), stats);
+	UE_LOG(LogPointCloudStream, Display, TEXT("Replayed %s: %s"), *args[0], *stats.ToString());
+}
+
+static FAutoConsoleCommand GReplayPointStreamCommand(
+	TEXT("PointCloud.Replay"),
+	TEXT("Replays a recorded point stream into a new streaming core and prints its throughput and latency. Usage: PointCloud.Replay <file> [realtime]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ReplayPointStreamCommand));
@@ -7,6 +7,20 @@
 #include "Engine/World.h"
 //#include "App.h"
 #include "Runtime/Engine/Classes/Materials/MaterialInstanceDynamic.h"
+#include "PointCloudDensityEstimator.h"
+#include "PointCloudSpatialSort.h"
+#include "PointCloudSharedMemoryConsumer.h"
+#include "PointCloudStreamRecorder.h"
+#include "PointCloudSpatialIndex.h"
+#include "PointCloudArchive.h"
+#include "PointCloudMemoryManager.h"
+#include "PointCloudLayout.h"
+#include "PointCloudBlockCompression.h"
+#include "RenderUtils.h"
+#include "HAL/PlatformTime.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "Async/ParallelFor.h"
 //#include "ComputeShaderUsageExample.h"
 //#include "PixelShaderUsageExample.h"
 
@@ -16,7 +30,175 @@ using namespace std;
 DECLARE_CYCLE_STAT(TEXT("Update Texture Regions"), STAT_UpdateTextureRegions, STATGROUP_GPUPCR);
 DECLARE_CYCLE_STAT(TEXT("Sort Point Cloud Data"), STAT_SortPointCloudData, STATGROUP_GPUPCR);
 DECLARE_CYCLE_STAT(TEXT("Update Shader Textures"), STAT_UpdateShaderTextures, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Compute Adaptive Splat Sizes"), STAT_ComputeAdaptiveScaling, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Consume Shared Memory Frame"), STAT_ConsumeSharedMemoryFrame, STATGROUP_GPUPCR);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shared Memory Frames Skipped"), STAT_SharedMemoryFramesSkipped, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Update Spatial Index"), STAT_UpdateSpatialIndex, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Spatial Query"), STAT_SpatialQuery, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Append Snapshots"), STAT_AppendSnapshots, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Update Source"), STAT_UpdateSource, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Filter Points"), STAT_FilterPoints, STATGROUP_GPUPCR);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Filtered Points"), STAT_FilteredPoints, STATGROUP_GPUPCR);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Progressive Upload Bytes"), STAT_ProgressiveUploadBytes, STATGROUP_GPUPCR);
+DECLARE_CYCLE_STAT(TEXT("Compress Colors"), STAT_CompressColors, STATGROUP_GPUPCR);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Buffer Allocations"), STAT_BufferAllocations, STATGROUP_GPUPCR);
+
+/** Enqueues a texture region update. Unlike UTexture2D::UpdateTextureRegions(), the region is captured by value, so nothing has to be allocated and freed per update. */
+static void EnqueueTextureRegionUpdate(UTexture2D* texture, const FUpdateTextureRegion2D &region, uint32 srcPitch, uint32 srcBpp, const uint8* srcData)
+{
+	if (!texture || !texture->Resource || !srcData)
+		return;
 
+	// The source data is addressed relative to the start of the texture
+	FTextureResource* resource = texture->Resource;
+	const uint8* regionData = srcData + region.SrcY * srcPitch + region.SrcX * srcBpp;
+	ENQUEUE_RENDER_COMMAND(UpdatePointCloudTextureRegion)(
+		[resource, region, srcPitch, regionData](FRHICommandListImmediate &RHICmdList) {
+			if (resource->TextureRHI.IsValid())
+				RHIUpdateTexture2D(resource->TextureRHI->GetTexture2D(), 0, region, srcPitch, regionData);
+		});
+}
+
+/** Enqueues the update of a whole block-compressed texture. Block formats are written through a lock, as RHIUpdateTexture2D() does not support them on every RHI. */
+static void EnqueueCompressedTextureUpdate(UTexture2D* texture, const uint8* blockData, uint32 blockRowBytes, uint32 blockRowCount)
+{
+	if (!texture || !texture->Resource || !blockData)
+		return;
+
+	FTextureResource* resource = texture->Resource;
+	ENQUEUE_RENDER_COMMAND(UpdatePointCloudCompressedTexture)(
+		[resource, blockData, blockRowBytes, blockRowCount](FRHICommandListImmediate &RHICmdList) {
+			if (!resource->TextureRHI.IsValid())
+				return;
+			FRHITexture2D* textureRHI = resource->TextureRHI->GetTexture2D();
+			uint32 destStride = 0;
+			uint8* dest = (uint8*)RHILockTexture2D(textureRHI, 0, RLM_WriteOnly, destStride, false);
+			for (uint32 row = 0; row < blockRowCount; ++row)
+				FMemory::Memcpy(dest + row * destStride, blockData + row * blockRowBytes, blockRowBytes);
+			RHIUnlockTexture2D(textureRHI, 0, false);
+		});
+}
+
+template<typename T>
+void FPointCloudStreamingCore::ResizeBuffer(TArray<T> &buffer, int32 count)
+{
+	// The allocation is kept on shrinking, so it only grows up to the high-water mark
+	if (count > buffer.Max()) {
+		mAllocationCount++;
+		INC_DWORD_STAT(STAT_BufferAllocations);
+	}
+	buffer.SetNumUninitialized(count, false);
+}
+
+//////////////////////
+// FILTERING /////////
+//////////////////////
+
+template<typename PointFilter>
+int32 FPointCloudStreamingCore::CompactPoints(int32 pointCount, const PointFilter &filterPoint)
+{
+	const int32 chunkSize = 16384;
+	const int32 chunkCount = FMath::DivideAndRoundUp(pointCount, chunkSize);
+	mFilterChunkCounts.SetNumUninitialized(chunkCount, false);
+
+	FLinearColor* positions = mPointPosData.GetData();
+	uint32* colors = (uint32*)mPointColorData.GetData();
+
+	// Every chunk compacts its survivors to its own start. Writes never overtake reads, so this also works in place
+	ParallelFor(chunkCount, [&](int32 chunk) {
+		const int32 start = chunk * chunkSize;
+		const int32 end = FMath::Min(start + chunkSize, pointCount);
+		int32 target = start;
+		FLinearColor position;
+		uint32 color;
+		for (int32 i = start; i < end; ++i) {
+			if (filterPoint(i, position, color)) {
+				positions[target] = position;
+				colors[target] = color;
+				target++;
+			}
+		}
+		mFilterChunkCounts[chunk] = target - start;
+	});
+
+	// Close the gaps between the chunks, only the survivors are moved
+	int32 survivorCount = chunkCount > 0 ? mFilterChunkCounts[0] : 0;
+	for (int32 chunk = 1; chunk < chunkCount; ++chunk) {
+		const int32 count = mFilterChunkCounts[chunk];
+		if (count > 0 && survivorCount != chunk * chunkSize) {
+			FMemory::Memmove(positions + survivorCount, positions + chunk * chunkSize, count * sizeof(FLinearColor));
+			FMemory::Memmove(colors + survivorCount, colors + chunk * chunkSize, count * sizeof(uint32));
+		}
+		survivorCount += count;
+	}
+
+	return survivorCount;
+}
+
+template<typename PointSource>
+void FPointCloudStreamingCore::ApplyFilters(int32 pointCount, const PointSource &getPoint)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FilterPoints);
+
+	InitPointPosBuffer();
+	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
+	pointCount = FMath::Min(pointCount, (int32)mPointCount);
+
+	// Crop box and range in the packed layout (R = Z, G = X, B = Y, A = Z). Dot3 over R, G, B is the squared distance
+	const FBox box = mFilter.bCropToBox ? mFilter.CropBox : FBox(FVector(-BIG_NUMBER), FVector(BIG_NUMBER));
+	const VectorRegister boxMin = MakeVectorRegister(box.Min.Z, box.Min.X, box.Min.Y, box.Min.Z);
+	const VectorRegister boxMax = MakeVectorRegister(box.Max.Z, box.Max.X, box.Max.Y, box.Max.Z);
+	const FVector &origin = mFilter.RangeOrigin;
+	const VectorRegister rangeOrigin = MakeVectorRegister(origin.Z, origin.X, origin.Y, origin.Z);
+	const float minRangeSq = mFilter.bCropToRange ? FMath::Square(FMath::Max(mFilter.MinRange, 0.f)) : 0.f;
+	const float maxRangeSq = mFilter.bCropToRange && mFilter.MaxRange < BIG_NUMBER ? FMath::Square(mFilter.MaxRange) : MAX_flt;
+
+	int32 survivorCount = CompactPoints(pointCount, [&](int32 i, FLinearColor &outPosition, uint32 &outColor) {
+		getPoint(i, outPosition, outColor);
+		const VectorRegister position = VectorLoad(&outPosition.R);
+		if (VectorAnyGreaterThan(boxMin, position) || VectorAnyGreaterThan(position, boxMax))
+			return false;
+		const VectorRegister offset = VectorSubtract(position, rangeOrigin);
+		float distanceSq;
+		VectorStoreFloat1(VectorDot3(offset, offset), &distanceSq);
+		return distanceSq >= minRangeSq && distanceSq <= maxRangeSq;
+	});
+
+	// Statistical outlier removal on the cropped points
+	const int32 neighbourCount = FMath::Clamp(mFilter.OutlierNeighbourCount, 1, (int32)FPointCloudDensityEstimator::MaxNeighbourCount);
+	if (mFilter.bRemoveOutliers && survivorCount > neighbourCount) {
+
+		if (!mDensityEstimator)
+			mDensityEstimator = new FPointCloudDensityEstimator();
+		mDensityEstimator->Build(mPointPosData.GetData(), survivorCount);
+		mDensityEstimator->ComputeNeighbourDistances(neighbourCount, mNeighbourDistances);
+
+		double sum = 0.0;
+		double sumSq = 0.0;
+		for (int32 i = 0; i < survivorCount; ++i) {
+			sum += mNeighbourDistances[i];
+			sumSq += (double)mNeighbourDistances[i] * mNeighbourDistances[i];
+		}
+		const double mean = sum / survivorCount;
+		const double stdDev = FMath::Sqrt(FMath::Max(sumSq / survivorCount - mean * mean, 0.0));
+		const float threshold = (float)(mean + mFilter.OutlierStdDevMultiplier * stdDev);
+
+		const FLinearColor* positions = mPointPosData.GetData();
+		const uint32* colors = (const uint32*)mPointColorData.GetData();
+		survivorCount = CompactPoints(survivorCount, [&](int32 i, FLinearColor &outPosition, uint32 &outColor) {
+			outPosition = positions[i];
+			outColor = colors[i];
+			return mNeighbourDistances[i] <= threshold;
+		});
+	}
+
+	// The texels behind the survivors are not drawn (see GetDrawPointCount()), so they are left as they are
+	INC_DWORD_STAT_BY(STAT_FilteredPoints, pointCount - survivorCount);
+	mValidPointCount = survivorCount;
+	mIndexedPointCount = 0;
+}
 
 //////////////////////
 // MAIN FUNCTIONS ////
@@ -31,89 +213,418 @@ void FPointCloudStreamingCore::AddSnapshot(TArray<FLinearColor> &pointPositions,
 	if (mDeltaTime < mStreamCaptureSteps)
 		return;
 
-	Initialize(MAXTEXRES * MAXTEXRES);
+	if (mRecorder)
+		mRecorder->RecordSnapshot(pointPositions, pointColors, offsetTranslation, offsetRotation);
+
+	FPointCloudSnapshot snapshot;
+	snapshot.PointPositions = &pointPositions;
+	snapshot.PointColors = &pointColors;
+	snapshot.OffsetTranslation = offsetTranslation;
+	snapshot.OffsetRotation = offsetRotation;
+	AppendSnapshots(&snapshot, 1);
+	mDeltaTime = 0.f;
+}
+
+int32 FPointCloudStreamingCore::AddSnapshots(const TArray<FPointCloudSnapshot> &snapshots) {
+
+	if (mRecorder)
+		mRecorder->RecordSnapshots(snapshots);
+
+	return AppendSnapshots(snapshots.GetData(), snapshots.Num());
+}
+
+int32 FPointCloudStreamingCore::AppendSnapshots(const FPointCloudSnapshot* snapshots, int32 snapshotCount) {
+
+	SCOPE_CYCLE_COUNTER(STAT_AppendSnapshots);
+
+	const int32 capacity = MAXTEXRES * MAXTEXRES;
+	Initialize(capacity);
+	mCompressedColorData.Reset();
 	InitPointPosBuffer();
 	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
 
-	FVector tempPos;
+	// Unused texels have to stay empty, the buffers are only cleared when a new accumulation starts
+	if (mGlobalStreamCounter == 0) {
+		FMemory::Memzero(mPointPosData.GetData(), mPointPosData.Num() * sizeof(FLinearColor));
+		FMemory::Memzero(mPointColorData.GetData(), mPointColorData.Num());
+	}
 
-	for (int i = 0; i < pointPositions.Num(); ++i) {
-		
-		// Transform point
-		tempPos = FVector(pointPositions[i].G, pointPositions[i].B, pointPositions[i].R);
-		tempPos = offsetRotation.RotateVector(tempPos);
-		tempPos += offsetTranslation;
-
-		// Add current data to buffer
-		if (mPointPosData.IsValidIndex(i)) {
-			mPointPosData[mGlobalStreamCounter + i].A = tempPos.Z;
-			mPointPosData[mGlobalStreamCounter + i].G = tempPos.X;
-			mPointPosData[mGlobalStreamCounter + i].B = tempPos.Y;
-			mPointPosData[mGlobalStreamCounter + i].R = tempPos.Z;
+	// Precompute one matrix per snapshot and the disjoint target range of every job.
+	// The matrices work on the packed layout directly (R = Z, G = X, B = Y, A = Z), the translation is added separately.
+	const int32 jobSize = 16384;
+	const int32 packedAxis[4] = { 2, 0, 1, 2 };
+	TArray<FMatrix> &matrices = mSnapshotMatrices;
+	TArray<FVector4> &translations = mSnapshotTranslations;
+	TArray<FSnapshotTransformJob> &jobs = mSnapshotJobs;
+	ResizeBuffer(matrices, snapshotCount);
+	ResizeBuffer(translations, snapshotCount);
+	FMemory::Memzero(matrices.GetData(), snapshotCount * sizeof(FMatrix));
+	FMemory::Memzero(translations.GetData(), snapshotCount * sizeof(FVector4));
+	jobs.Reset();
+
+	const int32 firstPoint = mGlobalStreamCounter;
+	int32 offset = firstPoint;
+	int32 appendedSnapshots = 0;
+	for (int32 s = 0; s < snapshotCount; ++s) {
+
+		const FPointCloudSnapshot &snapshot = snapshots[s];
+		if (!snapshot.PointPositions || !snapshot.PointColors)
+			continue;
+		const int32 pointCount = FMath::Min(snapshot.PointPositions->Num(), snapshot.PointColors->Num() / 4);
+		if (pointCount <= 0 || offset + pointCount > capacity)
+			continue;
+
+		const FMatrix rotation = FRotationMatrix(snapshot.OffsetRotation);
+		for (int32 in = 0; in < 3; ++in)
+			for (int32 out = 0; out < 4; ++out)
+				matrices[s].M[in][out] = rotation.M[packedAxis[in]][packedAxis[out]];
+		const FVector &t = snapshot.OffsetTranslation;
+		translations[s] = FVector4(t.Z, t.X, t.Y, t.Z);
+
+		for (int32 source = 0; source < pointCount; source += jobSize)
+			jobs.Add(FSnapshotTransformJob{ s, source, offset + source, FMath::Min(jobSize, pointCount - source) });
+
+		offset += pointCount;
+		appendedSnapshots++;
+	}
+
+	if (offset == firstPoint || !mPointPosTexture)
+		return 0;
+
+	FLinearColor* targetPositions = mPointPosData.GetData();
+	uint8* targetColors = mPointColorData.GetData();
+	ParallelFor(jobs.Num(), [&](int32 j) {
+
+		const FSnapshotTransformJob &job = jobs[j];
+		const FPointCloudSnapshot &snapshot = snapshots[job.Snapshot];
+		const FMatrix* matrix = &matrices[job.Snapshot];
+		const VectorRegister translation = VectorLoad(&translations[job.Snapshot].X);
+		const FLinearColor* source = snapshot.PointPositions->GetData() + job.Source;
+		FLinearColor* target = targetPositions + job.Target;
+
+		for (int32 i = 0; i < job.Count; ++i) {
+			const VectorRegister position = VectorLoad(&source[i].R);
+			VectorStore(VectorAdd(VectorTransformVector(position, matrix), translation), &target[i].R);
 		}
-		if (mPointColorData.IsValidIndex(mGlobalStreamCounter + i)) {
-			mPointColorData[(mGlobalStreamCounter + i) * 4] = pointColors[i * 4];
-			mPointColorData[(mGlobalStreamCounter + i) * 4 + 1] = pointColors[i * 4 + 1];
-			mPointColorData[(mGlobalStreamCounter + i) * 4 + 2] = pointColors[i * 4 + 2];
-			mPointColorData[(mGlobalStreamCounter + i) * 4 + 3] = pointColors[i * 4 + 3];
+
+		FMemory::Memcpy(targetColors + job.Target * 4, snapshot.PointColors->GetData() + job.Source * 4, job.Count * 4);
+	});
+
+	mGlobalStreamCounter = offset;
+	mValidPointCount = mGlobalStreamCounter;
+
+	SortPointCloudData();
+	ComputeAdaptiveScaling();
+	UpdateDrawPointCount();
+	PadDrawnTexels(mPointPosData, mPointColorData);
+
+	// Sorting and adaptive scaling touch the whole buffer, otherwise only the rows of the new points are uploaded
+	if (mSortOrder != EPointCloudSortOrder::None || mUseAdaptiveSplatSize || mProgressiveLoading) {
+		UpdateTextureBuffer();
+	}
+	else {
+		const uint32 width = mPointPosTexture->GetSizeX();
+		const uint32 firstRow = firstPoint / width;
+		UploadTextureRows((const uint8*)targetPositions, targetColors, firstRow, FMath::DivideAndRoundUp(mDrawPointCount, width) - firstRow);
+	}
+
+	return appendedSnapshots;
+}
+
+int32 FPointCloudStreamingCore::RegisterSource(int32 maxPointCount) {
+
+	if (maxPointCount <= 0)
+		return INDEX_NONE;
+
+	FSourceSlot slot;
+	slot.MaxPointCount = maxPointCount;
+	const int32 sourceId = mSources.Add(slot);
+	if (!BuildSourceLayout()) {
+		mSources.RemoveAt(sourceId);
+		BuildSourceLayout();
+		return INDEX_NONE;
+	}
+
+	if (mRecorder)
+		mRecorder->RecordRegisterSource(sourceId, maxPointCount);
+	return sourceId;
+}
+
+void FPointCloudStreamingCore::ClearSources() {
+
+	if (mRecorder)
+		mRecorder->RecordClearSources();
+
+	mSources.Empty();
+	mSourceTextureSize = 0;
+}
+
+bool FPointCloudStreamingCore::BuildSourceLayout() {
+
+	mSourceTextureSize = 0;
+	if (mSources.Num() == 0)
+		return false;
+
+	// Smallest texture whose rows fit all slots
+	uint32 textureSize = 2;
+	for (;; textureSize *= 2) {
+		if (textureSize > MAXTEXRES)
+			return false;
+		uint32 rowCount = 0;
+		for (const FSourceSlot &slot : mSources)
+			rowCount += FMath::DivideAndRoundUp(slot.MaxPointCount, textureSize);
+		if (rowCount <= textureSize)
+			break;
+	}
+
+	Initialize(textureSize * textureSize);
+	InitPointPosBuffer();
+	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
+	mCompressedColorData.Reset();
+	if (!mPointPosTexture || mPointPosTexture->GetSizeX() < textureSize)
+		return false;
+	// The texture may be larger in streaming mode
+	textureSize = mPointPosTexture->GetSizeX();
+
+	uint32 row = 0;
+	for (FSourceSlot &slot : mSources) {
+		slot.FirstRow = row;
+		slot.RowCount = FMath::DivideAndRoundUp(slot.MaxPointCount, textureSize);
+		slot.PointCount = 0;
+		row += slot.RowCount;
+	}
+
+	FMemory::Memzero(mPointPosData.GetData(), mPointPosData.Num() * sizeof(FLinearColor));
+	FMemory::Memzero(mPointColorData.GetData(), mPointColorData.Num());
+	// Nothing is drawn until a source has points, see EndSourceUpdate()
+	mValidPointCount = 0;
+	mDrawPointCount = 0;
+	mIndexedPointCount = 0;
+	mSourceTextureSize = textureSize;
+	return UpdateTextureBuffer();
+}
+
+bool FPointCloudStreamingCore::BeginSourceUpdate(int32 sourceId, int32 &inOutPointCount, uint32 &outFirstPoint) {
+
+	if (!mSources.IsValidIndex(sourceId))
+		return false;
+
+	// Another input path replaced the texture in the meantime
+	if (!mPointPosTexture || mPointPosTexture->GetSizeX() != mSourceTextureSize || mPointPosDataPointer != &mPointPosData || mPointColorDataPointer != &mPointColorData)
+		if (!BuildSourceLayout())
+			return false;
+
+	const FSourceSlot &slot = mSources[sourceId];
+	inOutPointCount = FMath::Min(inOutPointCount, (int32)slot.MaxPointCount);
+	outFirstPoint = slot.FirstRow * mSourceTextureSize;
+	return true;
+}
+
+void FPointCloudStreamingCore::EndSourceUpdate(int32 sourceId, int32 pointCount) {
+
+	FSourceSlot &slot = mSources[sourceId];
+	const uint32 firstPoint = slot.FirstRow * mSourceTextureSize;
+	const bool wasEmpty = slot.PointCount == 0;
+	slot.PointCount = pointCount;
+	mIndexedPointCount = 0;
+
+	// All slot texels are drawn, the unused ones repeat the last point of the slot so they do not show up
+	if (pointCount > 0) {
+		PadSourceSlot(sourceId, firstPoint + pointCount - 1);
+		UploadTextureRows((const uint8*)mPointPosData.GetData(), mPointColorData.GetData(), slot.FirstRow, slot.RowCount);
+	}
+
+	// Empty slots repeat the first point of the first filled slot
+	int32 fillerSource = INDEX_NONE;
+	for (int32 i = 0; i < mSources.Num() && fillerSource == INDEX_NONE; ++i)
+		if (mSources[i].PointCount > 0)
+			fillerSource = i;
+	if (fillerSource != INDEX_NONE && (fillerSource == sourceId || wasEmpty != (pointCount == 0))) {
+		const uint32 fillerPoint = mSources[fillerSource].FirstRow * mSourceTextureSize;
+		for (int32 i = 0; i < mSources.Num(); ++i) {
+			if (mSources[i].PointCount > 0)
+				continue;
+			PadSourceSlot(i, fillerPoint);
+			UploadTextureRows((const uint8*)mPointPosData.GetData(), mPointColorData.GetData(), mSources[i].FirstRow, mSources[i].RowCount);
 		}
 	}
 
-	mGlobalStreamCounter += pointPositions.Num();
-	mPointCount = mGlobalStreamCounter;
+	const FSourceSlot &lastSlot = mSources.Last();
+	mValidPointCount = fillerSource != INDEX_NONE ? (lastSlot.FirstRow + lastSlot.RowCount) * mSourceTextureSize : 0;
+	mDrawPointCount = mValidPointCount;
+}
 
-	UpdateTextureBuffer();
-	mDeltaTime = 0.f;
+void FPointCloudStreamingCore::PadSourceSlot(int32 sourceId, uint32 fillerPoint) {
+
+	const FSourceSlot &slot = mSources[sourceId];
+	const uint32 firstPoint = slot.FirstRow * mSourceTextureSize + slot.PointCount;
+	const uint32 endPoint = (slot.FirstRow + slot.RowCount) * mSourceTextureSize;
+	const FLinearColor position = mPointPosData[fillerPoint];
+	uint32* colors = (uint32*)mPointColorData.GetData();
+	const uint32 color = colors[fillerPoint];
+	for (uint32 i = firstPoint; i < endPoint; ++i) {
+		mPointPosData[i] = position;
+		colors[i] = color;
+	}
+}
+
+bool FPointCloudStreamingCore::UpdateSource(int32 sourceId, const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors) {
+
+	SCOPE_CYCLE_COUNTER(STAT_UpdateSource);
+
+	int32 pointCount = FMath::Min(pointPositions.Num(), pointColors.Num() / 4);
+	uint32 firstPoint = 0;
+	if (!BeginSourceUpdate(sourceId, pointCount, firstPoint))
+		return false;
+
+	if (mRecorder)
+		mRecorder->RecordSourceUpdate(sourceId, pointPositions, pointColors);
+
+	FMemory::Memcpy(mPointPosData.GetData() + firstPoint, pointPositions.GetData(), pointCount * sizeof(FLinearColor));
+	FMemory::Memcpy(mPointColorData.GetData() + firstPoint * 4, pointColors.GetData(), pointCount * 4);
+
+	EndSourceUpdate(sourceId, pointCount);
+	return true;
+}
+
+bool FPointCloudStreamingCore::UpdateSource(int32 sourceId, const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors) {
+
+	SCOPE_CYCLE_COUNTER(STAT_UpdateSource);
+
+	int32 pointCount = FMath::Min(pointPositions.Num(), pointColors.Num());
+	uint32 firstPoint = 0;
+	if (!BeginSourceUpdate(sourceId, pointCount, firstPoint))
+		return false;
+
+	if (mRecorder)
+		mRecorder->RecordSourceUpdate(sourceId, pointPositions, pointColors);
+
+	FLinearColor* targetPositions = mPointPosData.GetData() + firstPoint;
+	uint8* targetColors = mPointColorData.GetData() + firstPoint * 4;
+	ParallelFor(FMath::DivideAndRoundUp(pointCount, 16384), [&](int32 chunk) {
+		const int32 end = FMath::Min((chunk + 1) * 16384, pointCount);
+		for (int32 i = chunk * 16384; i < end; ++i) {
+			PointCloudLayout::PackPosition(pointPositions[i], targetPositions[i]);
+			targetColors[i * 4] = pointColors[i].R;
+			targetColors[i * 4 + 1] = pointColors[i].G;
+			targetColors[i * 4 + 2] = pointColors[i].B;
+			targetColors[i * 4 + 3] = pointColors[i].A;
+		}
+	});
+
+	EndSourceUpdate(sourceId, pointCount);
+	return true;
 }
 
 bool FPointCloudStreamingCore::SetInput(TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors) {
 
 	check(pointPositions.Num() * 4 == pointColors.Num());
 
-	if (pointColors.Num() < pointPositions.Num() * 4)
-		pointColors.SetNumZeroed(pointPositions.Num() * 4);
-
-	Initialize(pointPositions.Num());
-	mPointPosDataPointer = &pointPositions;
-	mPointColorDataPointer = &pointColors;
+	if (mRecorder)
+		mRecorder->RecordInput(pointPositions, pointColors, pointPositions.Num());
+
+	const int32 pointCount = FMath::Min(pointPositions.Num(), pointColors.Num() / 4);
+	Initialize(pointCount);
+	mValidPointCount = FMath::Min((uint32)pointCount, mPointCount);
+	mIndexedPointCount = 0;
+
+	// Filtered input is compacted into the internal buffers, the given arrays stay untouched
+	if (mFilter.IsActive()) {
+		const FLinearColor* positions = pointPositions.GetData();
+		const uint32* colors = (const uint32*)pointColors.GetData();
+		ApplyFilters(pointCount, [positions, colors](int32 i, FLinearColor &outPosition, uint32 &outColor) {
+			outPosition = positions[i];
+			outColor = colors[i];
+		});
+		SortPointCloudData();
+		ComputeAdaptiveScaling();
+		return UploadPointCloudData();
+	}
 
-	// Resize arrays with zero values if neccessary
-	if (pointPositions.Num() < (int32)mPointCount)
-		pointPositions.SetNumZeroed(mPointCount);
-	if (pointColors.Num() < (int32)mPointCount*4)
-		pointColors.SetNumZeroed(mPointCount*4);
+	// Copied into the internal buffers, which are padded and reordered instead of the given arrays
+	InitPointPosBuffer();
+	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
+	FMemory::Memcpy(mPointPosData.GetData(), pointPositions.GetData(), mValidPointCount * sizeof(FLinearColor));
+	FMemory::Memcpy(mPointColorData.GetData(), pointColors.GetData(), mValidPointCount * 4);
 
-	return UpdateTextureBuffer();
+	SortPointCloudData();
+	ComputeAdaptiveScaling();
+	return UploadPointCloudData();
 }
 
 bool FPointCloudStreamingCore::SetInput(TArray<FLinearColor> &pointPositions, TArray<FColor> &pointColors) {
 
 	ensure(pointPositions.Num() == pointColors.Num());
 
+	if (mRecorder)
+		mRecorder->RecordInput(pointPositions, pointColors);
+
 	Initialize(pointPositions.Num());
+	mValidPointCount = pointPositions.Num();
+	mIndexedPointCount = 0;
+
+	if (mFilter.IsActive()) {
+		const FLinearColor* positions = pointPositions.GetData();
+		const FColor* colors = pointColors.GetData();
+		ApplyFilters(FMath::Min(pointPositions.Num(), pointColors.Num()), [positions, colors](int32 i, FLinearColor &outPosition, uint32 &outColor) {
+			outPosition = positions[i];
+			outColor = PointCloudLayout::PackColor(colors[i]);
+		});
+		SortPointCloudData();
+		ComputeAdaptiveScaling();
+		return UploadPointCloudData();
+	}
+
+	InitPointPosBuffer();
 	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
+	const int32 pointCount = FMath::Min3(pointPositions.Num(), pointColors.Num(), (int32)mPointCount);
 
-	for (int i = 0; i < pointColors.Num(); ++i) {
+	for (int i = 0; i < pointCount; ++i) {
 
 		mPointColorData[i * 4] = pointColors[i].R;
 		mPointColorData[i * 4 + 1] = pointColors[i].G;
 		mPointColorData[i * 4 + 2] = pointColors[i].B;
 		mPointColorData[i * 4 + 3] = pointColors[i].A;
 	}
-	mPointPosDataPointer = &pointPositions;
-
-	// Resize arrays with zero values if neccessary
-	if (pointPositions.Num() < (int32)mPointCount)
-		pointPositions.SetNumZeroed(mPointCount);
+	FMemory::Memcpy(mPointPosData.GetData(), pointPositions.GetData(), pointCount * sizeof(FLinearColor));
+	mValidPointCount = pointCount;
 
-	return UpdateTextureBuffer();
+	SortPointCloudData();
+	ComputeAdaptiveScaling();
+	return UploadPointCloudData();
 }
 
 bool FPointCloudStreamingCore::SetInput(TArray<FVector> &pointPositions, TArray<FColor> &pointColors) {
 
 	ensure(pointPositions.Num() == pointColors.Num());
 
+	if (mRecorder)
+		mRecorder->RecordInput(pointPositions, pointColors);
+
 	Initialize(pointPositions.Num());
+	mValidPointCount = pointPositions.Num();
+	mIndexedPointCount = 0;
+
+	if (mFilter.IsActive()) {
+		const FVector* positions = pointPositions.GetData();
+		const FColor* colors = pointColors.GetData();
+		ApplyFilters(FMath::Min(pointPositions.Num(), pointColors.Num()), [positions, colors](int32 i, FLinearColor &outPosition, uint32 &outColor) {
+			PointCloudLayout::PackPosition(positions[i], outPosition);
+			outColor = PointCloudLayout::PackColor(colors[i]);
+		});
+		SortPointCloudData();
+		ComputeAdaptiveScaling();
+		return UploadPointCloudData();
+	}
+
 	InitPointPosBuffer();
 	InitColorBuffer();
 
@@ -132,15 +643,222 @@ bool FPointCloudStreamingCore::SetInput(TArray<FVector> &pointPositions, TArray<
 		mPointColorData[i * 4 + 2] = pointColors[i].B;
 		mPointColorData[i * 4 + 3] = pointColors[i].A;
 	}
-	
-	return UpdateTextureBuffer();
+
+	SortPointCloudData();
+	ComputeAdaptiveScaling();
+	return UploadPointCloudData();
+}
+
+bool FPointCloudStreamingCore::ConnectSharedMemory(const FString &segmentName, bool globalNamespace)
+{
+	if (!mSharedMemoryConsumer)
+		mSharedMemoryConsumer = new FPointCloudSharedMemoryConsumer();
+
+	return mSharedMemoryConsumer->Connect(segmentName, globalNamespace);
+}
+
+void FPointCloudStreamingCore::DisconnectSharedMemory()
+{
+	if (mSharedMemoryConsumer) delete mSharedMemoryConsumer; mSharedMemoryConsumer = nullptr;
+}
+
+unsigned int FPointCloudStreamingCore::GetSharedMemoryCapacity()
+{
+	return mSharedMemoryConsumer ? mSharedMemoryConsumer->GetMaxPointsPerFrame() : 0;
+}
+
+bool FPointCloudStreamingCore::ConsumeSharedMemoryFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ConsumeSharedMemoryFrame);
+
+	if (!mSharedMemoryConsumer || !mSharedMemoryConsumer->IsConnected())
+		return false;
+
+	const FLinearColor* positions = nullptr;
+	const uint8* colors = nullptr;
+	uint32 pointCount = 0;
+	double timestamp = 0.0;
+	const uint64 skippedFrames = mSharedMemoryConsumer->GetSkippedFrameCount();
+	if (!mSharedMemoryConsumer->AcquireLatestFrame(positions, colors, pointCount, timestamp))
+		return false;
+	INC_DWORD_STAT_BY(STAT_SharedMemoryFramesSkipped, (uint32)(mSharedMemoryConsumer->GetSkippedFrameCount() - skippedFrames));
+
+	// The producer lays out its frames for exactly this texture size, so the streaming mode must not keep a larger one
+	Initialize(mSharedMemoryConsumer->GetMaxPointsPerFrame(), true);
+	if (!mPointPosTexture || !mPointColorTexture || mPointCount != mSharedMemoryConsumer->GetMaxPointsPerFrame()) {
+		mSharedMemoryConsumer->SubmitFrame();
+		return false;
+	}
+
+	const uint32 width = mPointPosTexture->GetSizeX();
+	mValidPointCount = FMath::Min(pointCount, mPointCount);
+	mIndexedPointCount = 0;
+	UpdateDrawPointCount();
+	mProgressiveUploadPending = false;
+
+	// Only the rows of this frame are uploaded, the rows behind it are not drawn
+	const uint32 fullRows = mValidPointCount / width;
+	UploadTextureRows((const uint8*)positions, colors, 0, fullRows);
+
+	// The rest is staged in the CPU buffers, where the streaming mode pads it up to the drawn point count
+	const uint32 drawRows = FMath::DivideAndRoundUp(mDrawPointCount, width);
+	if (drawRows > fullRows) {
+		InitPointPosBuffer();
+		InitColorBuffer();
+		const uint32 first = FMath::Min(fullRows * width, mValidPointCount - 1);
+		FMemory::Memcpy(mPointPosData.GetData() + first, positions + first, (mValidPointCount - first) * sizeof(FLinearColor));
+		FMemory::Memcpy(mPointColorData.GetData() + first * 4, colors + first * 4, (mValidPointCount - first) * 4);
+		PadDrawnTexels(mPointPosData, mPointColorData);
+		UploadTextureRows((const uint8*)mPointPosData.GetData(), mPointColorData.GetData(), fullRows, drawRows - fullRows);
+	}
+
+	// The frame is not kept in the CPU buffers, so its bounds are unknown
+	mBounds = FBox(ForceInit);
+	mBoundsDirty = false;
+	mSharedMemoryConsumer->SubmitFrame();
+	return true;
+}
+
+bool FPointCloudStreamingCore::StartRecording(const FString &filePath)
+{
+	StopRecording();
+
+	mRecorder = new FPointCloudStreamRecorder();
+	if (!mRecorder->Open(filePath)) {
+		StopRecording();
+		return false;
+	}
+
+	// Updates of sources that were registered before refer to them
+	if (mSources.Num() > 0) {
+		mRecorder->RecordClearSources();
+		for (int32 i = 0; i < mSources.Num(); ++i)
+			mRecorder->RecordRegisterSource(i, mSources[i].MaxPointCount);
+	}
+	return true;
+}
+
+void FPointCloudStreamingCore::StopRecording()
+{
+	if (mRecorder) delete mRecorder; mRecorder = nullptr;
+}
+
+bool FPointCloudStreamingCore::UpdateSpatialIndex()
+{
+	SCOPE_CYCLE_COUNTER(STAT_UpdateSpatialIndex);
+
+	// Shared-memory frames are uploaded in place, there is no CPU-side copy to index
+	if (!mPointPosDataPointer || (mSharedMemoryConsumer && mSharedMemoryConsumer->IsConnected()))
+		return false;
+
+	if (!mSpatialIndex)
+		mSpatialIndex = new FPointCloudSpatialIndex();
+
+	const unsigned int pointCount = FMath::Min(mValidPointCount, (unsigned int)mPointPosDataPointer->Num());
+	if (mIndexedPointCount == 0 || mIndexedPointCount > pointCount) {
+		mSpatialIndex->Reset();
+		mIndexedPointCount = 0;
+	}
+
+	// Only index what has been appended since the last query
+	if (mIndexedPointCount < pointCount) {
+		mSpatialIndex->AddBatch(mPointPosDataPointer->GetData() + mIndexedPointCount, pointCount - mIndexedPointCount, mIndexedPointCount);
+		mIndexedPointCount = pointCount;
+	}
+
+	return !mSpatialIndex->IsEmpty();
+}
+
+bool FPointCloudStreamingCore::RaycastPoint(const FVector &origin, const FVector &direction, float maxDistance, float tolerance, int32 &outIndex, FVector &outPosition)
+{
+	if (!UpdateSpatialIndex())
+		return false;
+
+	SCOPE_CYCLE_COUNTER(STAT_SpatialQuery);
+	return mSpatialIndex->Raycast(origin, direction, maxDistance, tolerance, outIndex, outPosition);
+}
+
+void FPointCloudStreamingCore::FindPointsInRadius(const FVector &center, float radius, TArray<int32> &outIndices, TArray<FVector> &outPositions)
+{
+	outIndices.Reset();
+	outPositions.Reset();
+	if (!UpdateSpatialIndex())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_SpatialQuery);
+	mSpatialIndex->FindInRadius(center, radius, outIndices, outPositions);
+}
+
+void FPointCloudStreamingCore::FindPointsInBox(const FBox &box, TArray<int32> &outIndices, TArray<FVector> &outPositions)
+{
+	outIndices.Reset();
+	outPositions.Reset();
+	if (!UpdateSpatialIndex())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_SpatialQuery);
+	mSpatialIndex->FindInBox(box, outIndices, outPositions);
+}
+
+void FPointCloudStreamingCore::FindNearestPoints(const FVector &center, int32 count, TArray<int32> &outIndices, TArray<FVector> &outPositions)
+{
+	outIndices.Reset();
+	outPositions.Reset();
+	if (!UpdateSpatialIndex())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_SpatialQuery);
+	mSpatialIndex->FindNearest(center, count, outIndices, outPositions);
+}
+
+bool FPointCloudStreamingCore::SaveArchive(const FString &filePath, float precision, FPointCloudArchiveStats* outStats)
+{
+	// Shared-memory frames never reach the CPU buffers
+	if (!mPointPosDataPointer || !mPointColorDataPointer || (mSharedMemoryConsumer && mSharedMemoryConsumer->IsConnected()))
+		return false;
+
+	const int32 pointCount = FMath::Min3((int32)mValidPointCount, mPointPosDataPointer->Num(), mPointColorDataPointer->Num() / 4);
+	return FPointCloudArchive::Write(filePath, mPointPosDataPointer->GetData(), mPointColorDataPointer->GetData(), pointCount, precision, outStats);
+}
+
+bool FPointCloudStreamingCore::LoadArchive(const FString &filePath, FPointCloudArchiveStats* outStats)
+{
+	FPointCloudArchive archive;
+	if (!archive.Open(filePath) || archive.GetPointCount() > MAXTEXRES * MAXTEXRES)
+		return false;
+
+	const int32 pointCount = archive.GetPointCount();
+	Initialize(pointCount);
+	mValidPointCount = pointCount;
+	mIndexedPointCount = 0;
+	InitPointPosBuffer();
+	InitColorBuffer();
+	mPointPosDataPointer = &mPointPosData;
+	mPointColorDataPointer = &mPointColorData;
+
+	// Decode straight into the upload buffers, only the padding is cleared. A corrupt archive leaves no valid points behind
+	if (!archive.Read(mPointPosData.GetData(), mPointColorData.GetData(), outStats)) {
+		mValidPointCount = 0;
+		mDrawPointCount = 0;
+		mGlobalStreamCounter = 0;
+		mProgressiveUploadPending = false;
+		return false;
+	}
+	FMemory::Memzero(mPointPosData.GetData() + pointCount, (mPointCount - pointCount) * sizeof(FLinearColor));
+	FMemory::Memzero(mPointColorData.GetData() + pointCount * 4, (mPointCount - pointCount) * 4);
+
+	if (mRecorder)
+		mRecorder->RecordInput(mPointPosData, mPointColorData, pointCount);
+
+	SortPointCloudData();
+	ComputeAdaptiveScaling();
+	return UploadPointCloudData();
 }
 
 void FPointCloudStreamingCore::InitColorBuffer()
 {
 	if (mPointColorData.Num() != mPointCount * 4) {
-		mPointColorData.Empty();
-		mPointColorData.AddUninitialized(mPointCount * 4); // 4 as we have bgra
+		ResizeBuffer(mPointColorData, mPointCount * 4); // 4 as we have bgra
 		mPointColorDataPointer = &mPointColorData;
 	}
 }
@@ -148,60 +866,175 @@ void FPointCloudStreamingCore::InitColorBuffer()
 void FPointCloudStreamingCore::InitPointPosBuffer()
 {
 	if (mPointPosData.Num() != mPointCount) {
-		mPointPosData.Empty();
-		mPointPosData.AddUninitialized(mPointCount);
+		ResizeBuffer(mPointPosData, mPointCount);
 		mPointPosDataPointer = &mPointPosData;
 	}
 }
 
+void FPointCloudStreamingCore::SetStreamingMode(bool enabled, int32 shrinkDelay)
+{
+	mStreamingMode = enabled;
+	mShrinkDelay = FMath::Max(shrinkDelay, 0);
+	mUndersizedInputCount = 0;
+	mUndersizedDrawCount = 0;
+}
+
+void FPointCloudStreamingCore::SetAdaptiveSplatSize(bool enabled, int32 neighbourCount, float minScale, float maxScale)
+{
+	mUseAdaptiveSplatSize = enabled;
+	mDensityNeighbourCount = FMath::Clamp(neighbourCount, 1, (int32)FPointCloudDensityEstimator::MaxNeighbourCount);
+	mMinSplatScale = FMath::Max(minScale, 0.f);
+	mMaxSplatScale = FMath::Max(maxScale, mMinSplatScale);
+
+	if (!enabled) {
+		for (FLinearColor &scaling : mPointScalingData)
+			scaling = FLinearColor::White;
+		if (mDensityEstimator) delete mDensityEstimator; mDensityEstimator = nullptr;
+		mNeighbourDistances.Empty();
+	}
+}
+
+void FPointCloudStreamingCore::ComputeAdaptiveScaling()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ComputeAdaptiveScaling);
+
+	if (!mUseAdaptiveSplatSize || !mPointPosDataPointer)
+		return;
+
+	const int32 pointCount = FMath::Min3((int32)mValidPointCount, mPointPosDataPointer->Num(), mPointScalingData.Num());
+	if (pointCount <= 1)
+		return;
+
+	if (!mDensityEstimator)
+		mDensityEstimator = new FPointCloudDensityEstimator();
+
+	mDensityEstimator->Build(mPointPosDataPointer->GetData(), pointCount);
+	mDensityEstimator->ComputeNeighbourDistances(mDensityNeighbourCount, mNeighbourDistances);
+
+	double distanceSum = 0.0;
+	for (int32 i = 0; i < pointCount; ++i)
+		distanceSum += mNeighbourDistances[i];
+	const float meanDistance = (float)(distanceSum / pointCount);
+	if (meanDistance <= SMALL_NUMBER)
+		return;
+
+	// Splat radius relative to the average neighbour distance, so the global splat size keeps its meaning
+	const float invMeanDistance = 1.f / meanDistance;
+	ParallelFor(pointCount, [&](int32 i) {
+		const float scale = FMath::Clamp(mNeighbourDistances[i] * invMeanDistance, mMinSplatScale, mMaxSplatScale);
+		mPointScalingData[i] = FLinearColor(scale, scale, scale, 1.f);
+	});
+}
+
 void FPointCloudStreamingCore::SortPointCloudData() {
 
 	SCOPE_CYCLE_COUNTER(STAT_SortPointCloudData);
 
+	if ((mSortOrder == EPointCloudSortOrder::None && !mProgressiveLoading) || !mPointPosDataPointer || !mPointColorDataPointer)
+		return;
+
+	const int32 pointCount = FMath::Min3((int32)mValidPointCount, mPointPosDataPointer->Num(), mPointColorDataPointer->Num() / 4);
+	if (pointCount <= 1)
+		return;
+
+	if (!mSpatialSorter)
+		mSpatialSorter = new FPointCloudSpatialSorter();
+
+	// An existing spatial index survives the sort: the points appended since the last query are indexed before they are scattered,
+	// afterwards all indices follow the permutation
+	const bool keepIndex = mSpatialIndex && mIndexedPointCount > 0 && mIndexedPointCount <= (unsigned int)pointCount;
+	if (keepIndex && mIndexedPointCount < (unsigned int)pointCount) {
+		mSpatialIndex->AddBatch(mPointPosDataPointer->GetData() + mIndexedPointCount, pointCount - mIndexedPointCount, mIndexedPointCount);
+		mIndexedPointCount = pointCount;
+	}
+
+	// Progressive loading needs every prefix to be a uniform subsample instead of a compact region
+	mSpatialSorter->Sort(mPointPosDataPointer->GetData(), pointCount, mExtent, mSortOrder == EPointCloudSortOrder::None ? EPointCloudSortOrder::Morton : mSortOrder);
+	if (mProgressiveLoading)
+		mSpatialSorter->InterleavePermutation();
+	mSpatialSorter->ApplyPermutation(mPointPosDataPointer->GetData(), mSortScratchPositions);
+	mSpatialSorter->ApplyPermutation((uint32*)mPointColorDataPointer->GetData(), mSortScratchColors);
+
+	if (keepIndex)
+		mSpatialIndex->RemapIndices(mSpatialSorter->GetPermutation());
+	else
+		mIndexedPointCount = 0;
 }
 
-void FPointCloudStreamingCore::Initialize(unsigned int pointCount)
+void FPointCloudStreamingCore::Initialize(unsigned int pointCount, bool exactSize)
 {
 	if (pointCount == 0)
 		return;
 
+	// Evicted data is brought back first, e.g. snapshots are appended to it
+	if (mEvictedTextureSize > 0)
+		RestoreTextures();
+
 	int32 pointsPerAxis = FMath::CeilToInt(FMath::Sqrt(pointCount));
 	// Ensure even-sized, power-of-two textures to avoid inaccuracies
 	if (pointsPerAxis % 2 == 1) pointsPerAxis++;
 	pointsPerAxis = GetUpperPowerOfTwo(pointsPerAxis);
 
+	// Streaming mode keeps the high-water mark texture size (the drawn point count follows the input), unless the input needed a smaller texture for mShrinkDelay inputs in a row
+	if (exactSize) {
+		mUndersizedInputCount = 0;
+		mUndersizedDrawCount = 0;
+	}
+	else if (mStreamingMode && mPointPosTexture) {
+		const int32 textureSize = mPointPosTexture->GetSizeX();
+		if (pointsPerAxis >= textureSize) {
+			mUndersizedInputCount = 0;
+			mUndersizedDrawCount = 0;
+		}
+		else if (++mUndersizedInputCount <= mShrinkDelay)
+			pointsPerAxis = textureSize;
+		else
+			mUndersizedInputCount = 0;
+	}
+	const bool shrink = mPointPosTexture && pointsPerAxis < (int32)mPointPosTexture->GetSizeX();
+
 	// Check if update is neccessary
-	if (mPointPosTexture && mPointColorTexture && mPointScalingTexture && mUpdateTextureRegion)
+	if (mPointPosTexture && mPointColorTexture && mPointScalingTexture)
 		if (mPointPosTexture->GetSizeX() == pointsPerAxis && mPointColorTexture->GetSizeX() == pointsPerAxis && mPointScalingTexture->GetSizeX() == pointsPerAxis)
 			return;
 
 	mPointCount = pointsPerAxis * pointsPerAxis;
 
+	// The drawn point count of the former texture size must not outlive it
+	mDrawPointCount = FMath::Min(mDrawPointCount, mPointCount);
+	mUndersizedDrawCount = 0;
+
 	ResetPointData(pointsPerAxis);
 	CreateTextures(pointsPerAxis);
 
+	// Releases the capacity of a larger former point cloud
+	if (shrink) {
+		mPointPosData.Shrink();
+		mPointColorData.Shrink();
+		mPointScalingData.Shrink();
+	}
+
 	mGlobalStreamCounter = 0;
+	mIndexedPointCount = 0;
 }
 
 void FPointCloudStreamingCore::ResetPointData(const int32 &pointsPerAxis)
 {
-	mPointPosData.Empty();
-	mPointPosData.AddUninitialized(mPointCount);
+	ResizeBuffer(mPointPosData, mPointCount);
 	mPointPosDataPointer = &mPointPosData;
 
-	mPointColorData.Empty();
-	mPointColorData.AddUninitialized(mPointCount * 4);
+	ResizeBuffer(mPointColorData, mPointCount * 4);
 	mPointColorDataPointer = &mPointColorData;
 
-	mPointScalingData.Empty();
-	mPointScalingData.Init(FVector::OneVector, mPointCount);
-
-	if (mUpdateTextureRegion) delete mUpdateTextureRegion; mUpdateTextureRegion = nullptr;
-	mUpdateTextureRegion = new FUpdateTextureRegion2D(0, 0, 0, 0, pointsPerAxis, pointsPerAxis);
+	ResizeBuffer(mPointScalingData, mPointCount);
+	for (FLinearColor &scaling : mPointScalingData)
+		scaling = FLinearColor::White;
 }
 
-void FPointCloudStreamingCore::CreateTextures(const int32 &pointsPerAxis)
+void FPointCloudStreamingCore::CreateTextureResources(const int32 &pointsPerAxis)
 {
+	ReleaseTextures(true);
+
 	// create point cloud positions texture
 	mPointPosTexture = UTexture2D::CreateTransient(pointsPerAxis, pointsPerAxis, EPixelFormat::PF_A32B32G32R32F);
 	mPointPosTexture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
@@ -222,33 +1055,171 @@ void FPointCloudStreamingCore::CreateTextures(const int32 &pointsPerAxis)
 	mPointScalingTexture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
 #endif
 
+	mAllocationCount += 2;
+	INC_DWORD_STAT_BY(STAT_BufferAllocations, 2);
+
 	// create color texture
-	mPointColorTexture = UTexture2D::CreateTransient(pointsPerAxis, pointsPerAxis, EPixelFormat::PF_B8G8R8A8);
+	CreateColorTexture(pointsPerAxis, EPixelFormat::PF_B8G8R8A8);
+
+	mPointPosTexture->WaitForStreaming();
+	mPointColorTexture->WaitForStreaming();
+	mPointScalingTexture->WaitForStreaming();
+
+	mEvictedTextureSize = 0;
+	ReportResidentBytes();
+}
+
+void FPointCloudStreamingCore::CreateColorTexture(const int32 &pointsPerAxis, EPixelFormat format, const TArray<uint8>* blockData)
+{
+	// The old texture is freed by the garbage collector once the material does not reference it anymore
+	if (mPointColorTexture && !GExitPurge)
+		mPointColorTexture->RemoveFromRoot();
+
+	mPointColorTexture = UTexture2D::CreateTransient(pointsPerAxis, pointsPerAxis, format);
+	mAllocationCount++;
+	INC_DWORD_STAT(STAT_BufferAllocations);
 	mPointColorTexture->CompressionSettings = TextureCompressionSettings::TC_Default;
 	mPointColorTexture->SRGB = 1;
 	mPointColorTexture->AddToRoot();
+
+	// Compressed colors are static, so the blocks are written to the mip before the resource is created instead of being uploaded as regions
+	if (blockData && mPointColorTexture->PlatformData && mPointColorTexture->PlatformData->Mips.Num() > 0) {
+		FTexture2DMipMap &mip = mPointColorTexture->PlatformData->Mips[0];
+		void* mipData = mip.BulkData.Lock(LOCK_READ_WRITE);
+		FMemory::Memcpy(mipData, blockData->GetData(), FMath::Min((int64)mip.BulkData.GetBulkDataSize(), (int64)blockData->Num()));
+		mip.BulkData.Unlock();
+	}
+
 	mPointColorTexture->UpdateResource();
 #if WITH_EDITOR 
 	mPointColorTexture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
 #endif
+}
 
-	mPointPosData.Empty();
-	mPointPosData.AddUninitialized(mPointCount);
+void FPointCloudStreamingCore::ReportResidentBytes()
+{
+	if (!mPointPosTexture || !mPointColorTexture)
+		return;
+
+	const int64 texelCount = (int64)mPointPosTexture->GetSizeX() * mPointPosTexture->GetSizeY();
+	const FPixelFormatInfo &colorFormat = GPixelFormats[mPointColorTexture->GetPixelFormat()];
+	const int64 colorBytes = texelCount / (colorFormat.BlockSizeX * colorFormat.BlockSizeY) * colorFormat.BlockBytes;
+	FPointCloudMemoryManager::Get().UpdateResidentBytes(this, texelCount * 2 * sizeof(FLinearColor) + colorBytes);
+}
+
+bool FPointCloudStreamingCore::CompressColors()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CompressColors);
+
+	mCompressedColorData.Reset();
+	if (mColorFormat == EPointCloudColorFormat::Uncompressed || mProgressiveLoading || !mPointPosDataPointer || !mPointColorDataPointer || !mPointPosTexture)
+		return false;
+	if (!GPixelFormats[FPointCloudBlockEncoder::GetPixelFormat(mColorFormat)].Supported)
+		return false;
+
+	const int32 textureSize = mPointPosTexture->GetSizeX();
+	const int32 texelCount = textureSize * textureSize;
+	const int32 pointCount = (int32)mValidPointCount;
+	if (textureSize % 4 != 0 || pointCount <= 0 || mPointPosDataPointer->Num() < texelCount || mPointColorDataPointer->Num() < texelCount * 4)
+		return false;
+
+	const double startTime = FPlatformTime::Seconds();
+	const bool hasScaling = mUseAdaptiveSplatSize && mPointScalingData.Num() == texelCount;
+
+	// Similar colors per block need spatially sorted points
+	if (mSortOrder == EPointCloudSortOrder::None && pointCount > 1) {
+		if (!mSpatialSorter)
+			mSpatialSorter = new FPointCloudSpatialSorter();
+		mSpatialSorter->Sort(mPointPosDataPointer->GetData(), pointCount, mExtent, EPointCloudSortOrder::Morton);
+		mSpatialSorter->ApplyPermutation(mPointPosDataPointer->GetData(), mSortScratchPositions);
+		mSpatialSorter->ApplyPermutation((uint32*)mPointColorDataPointer->GetData(), mSortScratchColors);
+		if (hasScaling)
+			mSpatialSorter->ApplyPermutation(mPointScalingData.GetData(), mSortScratchPositions);
+	}
+
+	// 16 consecutive points per 4x4 block, the points stay in the first pointCount texels
+	FPointCloudBlockEncoder::BuildBlockLinearLayout(textureSize, pointCount, mBlockLayoutIndices);
+	FPointCloudBlockEncoder::ApplyLayout(mPointPosDataPointer->GetData(), mBlockLayoutIndices, mSortScratchPositions);
+	FPointCloudBlockEncoder::ApplyLayout((uint32*)mPointColorDataPointer->GetData(), mBlockLayoutIndices, mSortScratchColors);
+	if (hasScaling)
+		FPointCloudBlockEncoder::ApplyLayout(mPointScalingData.GetData(), mBlockLayoutIndices, mSortScratchPositions);
+	mIndexedPointCount = 0;
+
+	const float rmsError = FPointCloudBlockEncoder::Encode(mPointColorDataPointer->GetData(), textureSize, mColorFormat, pointCount, mCompressedColorData);
+	mCompressedColorFormat = mColorFormat;
+
+	mColorCompressionStats.PointCount = pointCount;
+	mColorCompressionStats.UncompressedBytes = (int64)texelCount * 4;
+	mColorCompressionStats.CompressedBytes = mCompressedColorData.Num();
+	mColorCompressionStats.EncodeSeconds = FPlatformTime::Seconds() - startTime;
+	mColorCompressionStats.RmsError = rmsError;
+	return true;
+}
+
+void FPointCloudStreamingCore::ReleaseTextures(bool clearMaterial)
+{
+	if (!mPointPosTexture && !mPointColorTexture && !mPointScalingTexture)
+		return;
+
+	// The textures are freed by the garbage collector once the material does not reference them anymore
+	if (clearMaterial) {
+		for (UMaterialInstanceDynamic* material : mDynamicMatInstances) {
+			material->SetTextureParameterValue("PositionTexture", nullptr);
+			material->SetTextureParameterValue("ColorTexture", nullptr);
+			if (mUseAdaptiveSplatSize)
+				material->SetTextureParameterValue("ScalingTexture", nullptr);
+		}
+	}
+	if (!GExitPurge) {
+		if (mPointPosTexture) mPointPosTexture->RemoveFromRoot();
+		if (mPointScalingTexture) mPointScalingTexture->RemoveFromRoot();
+		if (mPointColorTexture) mPointColorTexture->RemoveFromRoot();
+	}
+	mPointPosTexture = nullptr;
+	mPointScalingTexture = nullptr;
+	mPointColorTexture = nullptr;
+
+	FPointCloudMemoryManager::Get().UpdateResidentBytes(this, 0);
+}
+
+void FPointCloudStreamingCore::MarkVisible()
+{
+	FPointCloudMemoryManager::Get().MarkVisible(this);
+}
+
+void FPointCloudStreamingCore::EvictTextures()
+{
+	if (!mPointPosTexture)
+		return;
+
+	const int32 textureSize = mPointPosTexture->GetSizeX();
+	ReleaseTextures(true);
+	mEvictedTextureSize = textureSize;
+}
+
+bool FPointCloudStreamingCore::RestoreTextures()
+{
+	if (mEvictedTextureSize <= 0)
+		return false;
+
+	// The CPU buffers are still intact, only the textures have to be re-created and filled
+	CreateTextureResources(mEvictedTextureSize);
+	mProgressiveUploadPending = false;
+	const bool success = UpdateTextureBuffer();
+	UpdateShaderParameter();
+	return success;
+}
+
+void FPointCloudStreamingCore::CreateTextures(const int32 &pointsPerAxis)
+{
+	CreateTextureResources(pointsPerAxis);
+
+	// The CPU buffers are sized by ResetPointData()
 	if (!mPointPosDataPointer)
 		mPointPosDataPointer = &mPointPosData;
 	if (!mPointColorDataPointer)
 		mPointColorDataPointer = &mPointColorData;
 
-	mPointPosTexture->WaitForStreaming();
-	mPointColorTexture->WaitForStreaming();
-	mPointScalingTexture->WaitForStreaming();
-
-	mPointScalingData.Empty();
-	mPointScalingData.Init(FVector::OneVector, mPointCount);
-
-	if (mUpdateTextureRegion) delete mUpdateTextureRegion; mUpdateTextureRegion = nullptr;
-	mUpdateTextureRegion = new FUpdateTextureRegion2D(0, 0, 0, 0, pointsPerAxis, pointsPerAxis);
-
 	mGlobalStreamCounter = 0;
 }
 
@@ -264,40 +1235,258 @@ bool FPointCloudStreamingCore::UpdateTextureBuffer()
 		return false;
 	if (mPointColorDataPointer->Num() > mPointColorTexture->GetSizeX() * mPointColorTexture->GetSizeY() * 4 || mPointPosDataPointer->Num() > mPointPosTexture->GetSizeX()*mPointPosTexture->GetSizeY())
 		return false;
-	if (mUpdateTextureRegion == nullptr)
-		return false;
 
 	mPointPosTexture->WaitForStreaming();
 	mPointColorTexture->WaitForStreaming();
 	//mPointScalingTexture->WaitForStreaming();
 
-	mPointPosTexture->UpdateTextureRegions(0, 1, mUpdateTextureRegion, mPointPosTexture->GetSizeX() * sizeof(FLinearColor), sizeof(FLinearColor), (uint8*)mPointPosDataPointer->GetData());
-	mPointColorTexture->UpdateTextureRegions(0, 1, mUpdateTextureRegion, mPointColorTexture->GetSizeX() * sizeof(uint8) * 4, 4, mPointColorDataPointer->GetData());
-	//if(mHasSurfaceReconstructed)
-	//	mPointScalingTexture->UpdateTextureRegions(0, 1, mUpdateTextureRegion, mPointPosTexture->GetSizeX() * sizeof(FVector), sizeof(FVector), (uint8*)mPointScalingData.GetData());
+	// Only the drawn rows, the rest of the texture is never read
+	const uint32 width = mPointPosTexture->GetSizeX();
+	const uint32 numRows = FMath::Min(FMath::DivideAndRoundUp(mDrawPointCount, width), (uint32)mPointPosTexture->GetSizeY());
+	const FUpdateTextureRegion2D region(0, 0, 0, 0, width, numRows);
+	if (numRows > 0)
+		EnqueueTextureRegionUpdate(mPointPosTexture, region, width * sizeof(FLinearColor), sizeof(FLinearColor), (const uint8*)mPointPosDataPointer->GetData());
+	if (mCompressedColorData.Num() > 0) {
+		// The compressed texture is only re-created if its format or size changed
+		const EPixelFormat format = FPointCloudBlockEncoder::GetPixelFormat(mCompressedColorFormat);
+		if (mPointColorTexture->GetPixelFormat() != format || mPointColorTexture->GetSizeX() != width) {
+			CreateColorTexture(width, format, &mCompressedColorData);
+			ReportResidentBytes();
+		}
+		else {
+			EnqueueCompressedTextureUpdate(mPointColorTexture, mCompressedColorData.GetData(), width / 4 * FPointCloudBlockEncoder::GetBlockBytes(mCompressedColorFormat), width / 4);
+		}
+	}
+	else {
+		if (mPointColorTexture->GetPixelFormat() != EPixelFormat::PF_B8G8R8A8) {
+			CreateColorTexture(mPointColorTexture->GetSizeX(), EPixelFormat::PF_B8G8R8A8);
+			ReportResidentBytes();
+		}
+		if (numRows > 0)
+			EnqueueTextureRegionUpdate(mPointColorTexture, region, width * sizeof(uint8) * 4, 4, mPointColorDataPointer->GetData());
+	}
+	if (numRows > 0 && mUseAdaptiveSplatSize && mPointScalingData.Num() == mPointScalingTexture->GetSizeX() * mPointScalingTexture->GetSizeY())
+		EnqueueTextureRegionUpdate(mPointScalingTexture, region, width * sizeof(FLinearColor), sizeof(FLinearColor), (const uint8*)mPointScalingData.GetData());
 
 	mPointPosTexture->WaitForStreaming();
 	mPointColorTexture->WaitForStreaming();
 
+	mProgressiveUploadPending = false;
+	mBoundsDirty = true;
 	return true;
 }
 
+bool FPointCloudStreamingCore::UploadPointCloudData()
+{
+	UpdateDrawPointCount();
+	if (mPointPosDataPointer && mPointColorDataPointer)
+		PadDrawnTexels(*mPointPosDataPointer, *mPointColorDataPointer);
+
+	// Static input, the colors are block-compressed if enabled
+	CompressColors();
+
+	if (!mProgressiveLoading)
+		return UpdateTextureBuffer();
+
+	if (!mPointColorDataPointer || !mPointPosDataPointer || !mPointPosTexture || !mPointColorTexture || !mPointScalingTexture)
+		return false;
+
+	// The rows are uploaded in the following Update() calls
+	mProgressiveUploadPending = true;
+	mProgressiveUploadedRows = 0;
+	return true;
+}
+
+void FPointCloudStreamingCore::UploadProgressiveSlice()
+{
+	if (!mProgressiveUploadPending || !mPointPosDataPointer || !mPointColorDataPointer || !mPointPosTexture)
+		return;
+
+	const uint32 width = mPointPosTexture->GetSizeX();
+	const uint32 height = mPointPosTexture->GetSizeY();
+	if ((uint32)mPointPosDataPointer->Num() < width * height || (uint32)mPointColorDataPointer->Num() < width * height * 4) {
+		mProgressiveUploadPending = false;
+		return;
+	}
+
+	// Only the rows that contain points, the rest of the texture is not drawn
+	const uint32 rowCount = FMath::Min(FMath::Max(FMath::DivideAndRoundUp(mDrawPointCount, width), 1u), height);
+	const bool uploadScaling = mUseAdaptiveSplatSize && (uint32)mPointScalingData.Num() == width * height;
+	const uint32 bytesPerRow = width * (sizeof(FLinearColor) + 4 + (uploadScaling ? sizeof(FLinearColor) : 0));
+	const uint32 numRows = FMath::Min(FMath::Max((uint32)mProgressiveBytesPerFrame / bytesPerRow, 1u), rowCount - FMath::Min(mProgressiveUploadedRows, rowCount));
+
+	UploadTextureRows((const uint8*)mPointPosDataPointer->GetData(), mPointColorDataPointer->GetData(), mProgressiveUploadedRows, numRows, uploadScaling ? (const uint8*)mPointScalingData.GetData() : nullptr);
+	INC_DWORD_STAT_BY(STAT_ProgressiveUploadBytes, numRows * bytesPerRow);
+
+	mProgressiveUploadedRows += numRows;
+	if (mProgressiveUploadedRows >= rowCount)
+		mProgressiveUploadPending = false;
+}
+
+unsigned int FPointCloudStreamingCore::GetDrawPointCount()
+{
+	if (!mProgressiveUploadPending || !mPointPosTexture)
+		return mDrawPointCount;
+
+	// Rows that are not uploaded yet still hold the previous cloud. Every prefix of the progressive order is a uniform subsample,
+	// the drawn prefix grows in powers of two, so the base mesh is rebuilt only a few times per upload
+	const unsigned int uploadedPoints = FMath::Min(mProgressiveUploadedRows * mPointPosTexture->GetSizeX(), mDrawPointCount);
+	if (uploadedPoints == 0 || uploadedPoints == mDrawPointCount)
+		return uploadedPoints;
+	return 1u << FMath::FloorLog2(uploadedPoints);
+}
+
+FBox FPointCloudStreamingCore::GetBounds()
+{
+	if (mExtent.IsValid && mExtent.GetVolume() > 0.f)
+		return mExtent;
+	if (!mBoundsDirty)
+		return mBounds;
+	mBoundsDirty = false;
+	mBounds = FBox(ForceInit);
+	if (!mPointPosDataPointer)
+		return mBounds;
+
+	const int32 pointCount = FMath::Min((int32)mDrawPointCount, mPointPosDataPointer->Num());
+	const FLinearColor* positions = mPointPosDataPointer->GetData();
+	mChunkBounds.SetNumUninitialized(FMath::DivideAndRoundUp(pointCount, 16384), false);
+	ParallelFor(mChunkBounds.Num(), [&](int32 chunk) {
+		const int32 end = FMath::Min((chunk + 1) * 16384, pointCount);
+		FVector minPos(BIG_NUMBER), maxPos(-BIG_NUMBER);
+		for (int32 i = chunk * 16384; i < end; ++i) {
+			const FVector pos = PointCloudLayout::UnpackPosition(positions[i]);
+			minPos = minPos.ComponentMin(pos);
+			maxPos = maxPos.ComponentMax(pos);
+		}
+		mChunkBounds[chunk] = FBox(minPos, maxPos);
+	});
+	for (const FBox &chunkBox : mChunkBounds)
+		mBounds += chunkBox;
+	return mBounds;
+}
+
+void FPointCloudStreamingCore::UpdateDrawPointCount()
+{
+	if (mValidPointCount == 0 || !mPointPosTexture) {
+		mDrawPointCount = mValidPointCount;
+		return;
+	}
+
+	// Whole eighths of the texture, so the base mesh is only rebuilt if the point count changed by more than a few rows.
+	// The streaming mode shrinks with the same hysteresis as the texture size in Initialize()
+	const unsigned int width = mPointPosTexture->GetSizeX();
+	const unsigned int step = width * FMath::Max(width / 8, 1u);
+	const unsigned int drawCount = FMath::Min(FMath::DivideAndRoundUp(mValidPointCount, step) * step, mPointCount);
+	const unsigned int previousDrawCount = FMath::Min(mDrawPointCount, mPointCount);
+	if (drawCount >= previousDrawCount)
+		mUndersizedDrawCount = 0;
+	else if (mStreamingMode && ++mUndersizedDrawCount <= mShrinkDelay) {
+		mDrawPointCount = previousDrawCount;
+		return;
+	}
+	else
+		mUndersizedDrawCount = 0;
+	mDrawPointCount = drawCount;
+}
+
+void FPointCloudStreamingCore::PadDrawnTexels(TArray<FLinearColor> &positions, TArray<uint8> &colors)
+{
+	const unsigned int padEnd = FMath::Min(mDrawPointCount, (unsigned int)FMath::Min(positions.Num(), colors.Num() / 4));
+	if (padEnd <= mValidPointCount || mValidPointCount == 0)
+		return;
+
+	// The texels behind the input are drawn as well, they repeat its last point so they do not show up
+	const unsigned int last = mValidPointCount - 1;
+	const FLinearColor position = positions[last];
+	uint32* colorData = (uint32*)colors.GetData();
+	const uint32 color = colorData[last];
+	for (unsigned int i = mValidPointCount; i < padEnd; ++i) {
+		positions[i] = position;
+		colorData[i] = color;
+	}
+	if (mUseAdaptiveSplatSize) {
+		const unsigned int scalingEnd = FMath::Min(padEnd, (unsigned int)mPointScalingData.Num());
+		for (unsigned int i = mValidPointCount; i < scalingEnd; ++i)
+			mPointScalingData[i] = mPointScalingData[last];
+	}
+}
+
+void FPointCloudStreamingCore::SetProgressiveLoading(bool enabled, int32 bytesPerFrame)
+{
+	mProgressiveLoading = enabled;
+	mProgressiveBytesPerFrame = FMath::Max(bytesPerFrame, 1);
+}
+
+void FPointCloudStreamingCore::UploadTextureRows(const uint8* positionData, const uint8* colorData, uint32 firstRow, uint32 numRows, const uint8* scalingData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_UpdateTextureRegions);
+
+	if (!mPointPosTexture || !mPointColorTexture || !positionData || !colorData)
+		return;
+
+	const uint32 width = mPointPosTexture->GetSizeX();
+	const uint32 height = mPointPosTexture->GetSizeY();
+	if (firstRow >= height)
+		return;
+	numRows = FMath::Min(numRows, height - firstRow);
+
+	// Rows can only be updated in the uncompressed color texture
+	mCompressedColorData.Reset();
+	if (mPointColorTexture->GetPixelFormat() != EPixelFormat::PF_B8G8R8A8) {
+		CreateColorTexture(width, EPixelFormat::PF_B8G8R8A8);
+		ReportResidentBytes();
+	}
+
+	// The source data is addressed relative to the start of the texture
+	const FUpdateTextureRegion2D region(0, firstRow, 0, firstRow, width, numRows);
+	EnqueueTextureRegionUpdate(mPointPosTexture, region, width * sizeof(FLinearColor), sizeof(FLinearColor), positionData);
+	EnqueueTextureRegionUpdate(mPointColorTexture, region, width * sizeof(uint8) * 4, 4, colorData);
+	if (scalingData && mPointScalingTexture)
+		EnqueueTextureRegionUpdate(mPointScalingTexture, region, width * sizeof(FLinearColor), sizeof(FLinearColor), scalingData);
+	mBoundsDirty = true;
+}
+
 void FPointCloudStreamingCore::UpdateShaderParameter()
 {
 	SCOPE_CYCLE_COUNTER(STAT_UpdateShaderTextures);
 
 	if (!mPointPosTexture || !mPointColorTexture || !mPointScalingTexture)
 		return;
-	if (!mDynamicMatInstance)
+
+	for (UMaterialInstanceDynamic* material : mDynamicMatInstances) {
+		material->SetTextureParameterValue("PositionTexture", mPointPosTexture);
+		material->SetTextureParameterValue("ColorTexture", mPointColorTexture);
+		if (mUseAdaptiveSplatSize)
+			material->SetTextureParameterValue("ScalingTexture", mPointScalingTexture);
+		material->SetScalarParameterValue("TextureSize", (float)mPointPosTexture->GetSizeX());
+		material->SetVectorParameterValue("minExtent", mExtent.Min);
+		material->SetVectorParameterValue("maxExtent", mExtent.Max);
+	}
+}
+
+void FPointCloudStreamingCore::Update(float deltaTime)
+{
+	// A shared core is ticked by all of its components, but has to stream and upload only once per frame
+	if (mLastUpdateFrame == GFrameCounter)
 		return;
+	mLastUpdateFrame = GFrameCounter;
+
+	ConsumeSharedMemoryFrame();
+	UploadProgressiveSlice();
+	UpdateShaderParameter();
+	mDeltaTime += deltaTime;
+}
+
+void FPointCloudStreamingCore::UpdateDynamicMaterialForStreaming(UMaterialInstanceDynamic* pointCloudShaderDynInstance)
+{
+	mDynamicMatInstances.Reset();
+	AddMaterialInstance(pointCloudShaderDynInstance);
+}
 
-	mDynamicMatInstance->SetTextureParameterValue("PositionTexture", mPointPosTexture);
-	mDynamicMatInstance->SetTextureParameterValue("ColorTexture", mPointColorTexture);
-	//if (mHasSurfaceReconstructed)
-	//	mDynamicMatInstance->SetTextureParameterValue("ScalingTexture", mPointScalingTexture);
-	mDynamicMatInstance->SetScalarParameterValue("TextureSize", (float)mPointPosTexture->GetSizeX());
-	mDynamicMatInstance->SetVectorParameterValue("minExtent", mExtent.Min);
-	mDynamicMatInstance->SetVectorParameterValue("maxExtent", mExtent.Max);
+void FPointCloudStreamingCore::AddMaterialInstance(UMaterialInstanceDynamic* pointCloudShaderDynInstance)
+{
+	if (pointCloudShaderDynInstance)
+		mDynamicMatInstances.AddUnique(pointCloudShaderDynInstance);
 }
 
 void FPointCloudStreamingCore::FreeData()
@@ -308,12 +1497,33 @@ void FPointCloudStreamingCore::FreeData()
 	mPointColorData.Empty();
 	mPointColorDataPointer = nullptr;
 	mPointScalingData.Empty();
-	if (mUpdateTextureRegion) delete mUpdateTextureRegion; mUpdateTextureRegion = nullptr;
+	mNeighbourDistances.Empty();
+	if (mDensityEstimator) delete mDensityEstimator; mDensityEstimator = nullptr;
+	if (mSpatialSorter) delete mSpatialSorter; mSpatialSorter = nullptr;
+	if (mSharedMemoryConsumer) delete mSharedMemoryConsumer; mSharedMemoryConsumer = nullptr;
+	if (mRecorder) delete mRecorder; mRecorder = nullptr;
+	if (mSpatialIndex) delete mSpatialIndex; mSpatialIndex = nullptr;
+	mIndexedPointCount = 0;
+	mSortScratchPositions.Empty();
+	mSortScratchColors.Empty();
+	mCompressedColorData.Empty();
+	mBlockLayoutIndices.Empty();
+	mSnapshotMatrices.Empty();
+	mSnapshotTranslations.Empty();
+	mSnapshotJobs.Empty();
+}
+
+FPointCloudStreamingCore::FPointCloudStreamingCore(UMaterialInstanceDynamic* pointCloudShaderDynInstance)
+{
+	AddMaterialInstance(pointCloudShaderDynInstance);
+	FPointCloudMemoryManager::Get().Register(this);
 }
 
 FPointCloudStreamingCore::~FPointCloudStreamingCore() {
 
 	FreeData();
+	ReleaseTextures(false);
+	FPointCloudMemoryManager::Get().Unregister(this);
 
 	//if (mPointPosTexture)
 	//	delete mPointPosTexture;
@@ -47,5 +47,12 @@ public:
 	*/
 	virtual FPointCloudStreamingCore* CreateStreamingInstance(UMaterialInstanceDynamic* pointCloudShaderDynInstance = nullptr) = 0;
 
+	/**
+	* Returns the shared instance of the Point Cloud Streaming Core class with the given name, creating it if necessary.
+	* All holders share the point data and textures (register their own materials via AddMaterialInstance()), so identical
+	* clouds placed many times are converted, stored and uploaded only once. The core is freed with its last reference.
+	*/
+	virtual TSharedPtr<FPointCloudStreamingCore> GetSharedStreamingInstance(FName dataName) = 0;
+
 };
 
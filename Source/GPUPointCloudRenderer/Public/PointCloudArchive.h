@@ -0,0 +1,94 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Size and timings of an archive write/read. RawBytes is the size of the points in the upload layout (RGBA32F + RGBA8).
+ */
+struct GPUPOINTCLOUDRENDERER_API FPointCloudArchiveStats
+{
+	int32 PointCount = 0;
+	int64 RawBytes = 0;
+	int64 FileBytes = 0;
+	double IOSeconds = 0.0;
+	double CodecSeconds = 0.0;
+
+	double GetCompressionRatio() const { return FileBytes > 0 ? (double)RawBytes / FileBytes : 0.0; };
+	FString ToString() const;
+};
+
+/**
+ * Compressed point cloud archive for stored scans and accumulated snapshots.
+ * The points are Morton-ordered and split into chunks of ChunkPointCount points that can be decoded independently (and in parallel).
+ * Per chunk, positions are quantized to the given precision and stored as delta-coded Morton keys (varints), colors are delta-coded
+ * per channel plane. Both streams are entropy coded with zlib. Decoding writes directly into the packed upload layout of the core.
+ * Mind that positions are lossy (within half the precision) and that the point order is not preserved.
+ */
+class GPUPOINTCLOUDRENDERER_API FPointCloudArchive
+{
+public:
+	static const int32 ChunkPointCount = 64 * 1024;
+	static const int32 ReadBatchBytes = 8 * 1024 * 1024;
+
+	/**
+	* Encodes the given points (in parallel) and writes them to an archive file.
+	*
+	* @param	filePath					The archive file to write.
+	* @param	pointPositions				The packed point positions.
+	* @param	pointColors					The point colors (4 bytes per point).
+	* @param	pointCount					The number of points.
+	* @param	precision					The quantization step of the positions. Clamped to what 21 bits per axis can represent.
+	* @param	outStats					Optional sizes and timings.
+	*/
+	static bool Write(const FString &filePath, const FLinearColor* pointPositions, const uint8* pointColors, int32 pointCount, float precision, FPointCloudArchiveStats* outStats = nullptr);
+
+	~FPointCloudArchive() { Close(); };
+
+	/** Opens an archive and reads its header and chunk table. */
+	bool Open(const FString &filePath);
+	void Close();
+	bool IsOpen() const { return mReader != nullptr; };
+
+	int32 GetPointCount() const { return mHeader.PointCount; };
+	FBox GetBounds() const;
+
+	/**
+	* Reads and decodes all chunks of the opened archive. The chunks are read in batches of about ReadBatchBytes into two alternating
+	* buffers, every batch is decoded in parallel while the next one is read.
+	*
+	* @param	outPositions				Packed positions, room for GetPointCount() points.
+	* @param	outColors					Colors, room for GetPointCount() * 4 bytes.
+	* @param	outStats					Optional sizes and timings.
+	*/
+	bool Read(FLinearColor* outPositions, uint8* outColors, FPointCloudArchiveStats* outStats = nullptr);
+
+private:
+	struct FFileHeader
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		int32 PointCount = 0;
+		int32 ChunkCount = 0;
+		float Origin[3] = { 0.f, 0.f, 0.f };
+		float Step = 1.f;
+		uint32 MaxKey[3] = { 0, 0, 0 };
+	};
+
+	struct FChunkEntry
+	{
+		int64 Offset;					// Relative to the end of the chunk table
+		int32 PointCount;
+		int32 PositionSize;
+		int32 PositionCompressedSize;	// Equals PositionSize if the stream is stored uncompressed
+		int32 ColorCompressedSize;		// Equals PointCount * 4 if the stream is stored uncompressed
+	};
+
+	FArchive* mReader = nullptr;
+	FFileHeader mHeader;
+	TArray<FChunkEntry> mChunks;
+	TArray<uint8> mReadBuffers[2];
+};
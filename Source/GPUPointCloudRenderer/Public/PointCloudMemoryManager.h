@@ -0,0 +1,52 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+class FPointCloudStreamingCore;
+
+/**
+ * Process-wide bookkeeping of the GPU texture memory of all streaming cores.
+ * Every core registers on construction and reports its resident texture memory. If the sum exceeds the budget
+ * (r.GPUPointCloud.MemoryBudgetMB), the textures of the least recently visible cores are released. Their CPU data is kept,
+ * so an evicted core is restored (re-created and re-uploaded) as soon as it is marked visible again.
+ */
+class GPUPOINTCLOUDRENDERER_API FPointCloudMemoryManager
+{
+public:
+	static FPointCloudMemoryManager& Get();
+
+	void Register(FPointCloudStreamingCore* core);
+	void Unregister(FPointCloudStreamingCore* core);
+
+	/** Reports the texture memory a core currently holds on the GPU (0 if released). Enforces the budget on growth. */
+	void UpdateResidentBytes(FPointCloudStreamingCore* core, int64 bytes);
+
+	/** Marks the core as visible in the current frame. Restores it if it was evicted. */
+	void MarkVisible(FPointCloudStreamingCore* core);
+
+	int64 GetBudgetBytes() const;
+	int64 GetResidentBytes() const { return mResidentBytes; };
+	int32 GetEvictionCount() const { return mEvictionCount; };
+
+private:
+	struct FEntry
+	{
+		int64 ResidentBytes = 0;
+		double LastVisibleTime = 0.0;
+		uint64 LastVisibleFrame = 0;
+		bool bEvicted = false;
+	};
+
+	void EnforceBudget(FPointCloudStreamingCore* requester);
+
+	TMap<FPointCloudStreamingCore*, FEntry> mEntries;
+	int64 mResidentBytes = 0;
+	int32 mEvictionCount = 0;
+	bool mIsEvicting = false;
+	mutable FCriticalSection mLock;
+};
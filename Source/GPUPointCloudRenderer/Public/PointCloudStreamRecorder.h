@@ -0,0 +1,151 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/Queue.h"
+#include "PointCloudStreamingCore.h"
+
+class FEvent;
+class FRunnableThread;
+
+/**
+ * Records every ingest call of a streaming core (SetInput/AddSnapshot/AddSnapshots/RegisterSource/UpdateSource) to a chunked, zlib-compressed stream on disk.
+ * Records are only copied into a chunk buffer on the calling thread, compression and disk I/O happen on a background thread.
+ * If the disk cannot keep up, at most maxPendingChunks chunks are queued, further records are dropped (and counted).
+ */
+class GPUPOINTCLOUDRENDERER_API FPointCloudStreamRecorder : public FRunnable
+{
+public:
+	FPointCloudStreamRecorder() {};
+	virtual ~FPointCloudStreamRecorder();
+
+	/** Creates the stream file and starts the writer thread. */
+	bool Open(const FString &filePath, int32 chunkSize = 16 * 1024 * 1024, int32 maxPendingChunks = 8);
+	/** Flushes the remaining records and closes the file. */
+	void Close();
+	bool IsOpen() const { return mWriterThread != nullptr; };
+
+	void RecordInput(const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors, int32 pointCount);
+	void RecordInput(const TArray<FLinearColor> &pointPositions, const TArray<FColor> &pointColors);
+	void RecordInput(const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors);
+	void RecordSnapshot(const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors, FVector offsetTranslation, FRotator offsetRotation);
+	/** Records an AddSnapshots call, it is replayed as a single batch as well. */
+	void RecordSnapshots(const TArray<FPointCloudSnapshot> &snapshots);
+	void RecordRegisterSource(int32 sourceId, int32 maxPointCount);
+	void RecordClearSources();
+	void RecordSourceUpdate(int32 sourceId, const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors);
+	void RecordSourceUpdate(int32 sourceId, const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors);
+
+	int64 GetRecordedBytes() const { return mRecordedBytes; };
+	int64 GetWrittenBytes() const { return mWrittenBytes; };
+	/** Records that were dropped since the writer thread fell behind. */
+	int64 GetDroppedRecordCount() const { return mDroppedRecords; };
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override { mStopRequested = true; };
+	//~ End FRunnable Interface
+
+private:
+	struct FChunk
+	{
+		TArray<uint8> Data;
+		int32 RecordCount = 0;
+	};
+
+	void AppendRecord(uint8 type, const void* positions, int32 positionBytes, const void* colors, int32 colorBytes, int32 pointCount, const FVector &translation, const FRotator &rotation, uint8 flags = 0, int32 sourceId = INDEX_NONE);
+	void FlushChunk();
+	void WriteChunk(FChunk* chunk);
+
+	FArchive* mWriter = nullptr;
+	FRunnableThread* mWriterThread = nullptr;
+	FEvent* mWorkEvent = nullptr;
+	FThreadSafeBool mStopRequested = false;
+
+	FChunk* mCurrentChunk = nullptr;
+	TQueue<FChunk*, EQueueMode::Spsc> mPendingChunks;
+	TQueue<FChunk*, EQueueMode::Spsc> mFreeChunks;
+	FThreadSafeCounter mPendingChunkCount;
+	int32 mMaxPendingChunks = 8;
+	TArray<uint8> mCompressionBuffer;
+
+	int32 mChunkSize = 0;
+	double mStartTime = 0.0;
+	int64 mRecordedBytes = 0;
+	int64 mWrittenBytes = 0;
+	int64 mDroppedRecords = 0;
+};
+
+/**
+ * Throughput and latency of a replayed stream. Latencies are measured around the ingest calls only (decoding excluded).
+ */
+struct GPUPOINTCLOUDRENDERER_API FPointCloudReplayStats
+{
+	int32 CallCount = 0;
+	int64 PointCount = 0;
+	double StreamDuration = 0.0;
+	double ReplayDuration = 0.0;
+	double DecodeSeconds = 0.0;
+	double IngestSeconds = 0.0;
+	double MinLatency = 0.0;
+	double MaxLatency = 0.0;
+
+	double GetPointsPerSecond() const { return IngestSeconds > 0.0 ? PointCount / IngestSeconds : 0.0; };
+	double GetAverageLatency() const { return CallCount > 0 ? IngestSeconds / CallCount : 0.0; };
+	FString ToString() const;
+};
+
+/**
+ * Feeds a recorded stream back into a streaming core, either with the recorded timing or as fast as possible.
+ */
+class GPUPOINTCLOUDRENDERER_API FPointCloudStreamReplayer
+{
+public:
+	~FPointCloudStreamReplayer() { Close(); };
+
+	bool Open(const FString &filePath);
+	void Close();
+	bool IsOpen() const { return mReader != nullptr; };
+
+	/** Replays the whole stream (blocking). Meant for headless benchmarks. */
+	bool ReplayAll(FPointCloudStreamingCore &core, bool realTime, FPointCloudReplayStats &outStats);
+
+	/**
+	* Replays all records that are due at the given playback time (seconds since the start of the recording). Meant to be called every tick.
+	* Returns false once the end of the stream is reached.
+	*/
+	bool ReplayUntil(FPointCloudStreamingCore &core, double playbackTime);
+
+	/** The stats of the tick-driven playback (ReplayUntil). */
+	const FPointCloudReplayStats& GetStats() const { return mStats; };
+
+private:
+	bool PeekNextTimestamp(double &outTimestamp);
+	bool ReadNextChunk();
+	bool ReplayNextRecord(FPointCloudStreamingCore &core, FPointCloudReplayStats &stats);
+
+	FArchive* mReader = nullptr;
+	TArray<uint8> mCompressedData;
+	TArray<uint8> mChunkData;
+	int32 mChunkOffset = 0;
+	int32 mChunkRecordsLeft = 0;
+	FPointCloudReplayStats mStats;
+
+	TArray<FLinearColor> mPositions;
+	TArray<FVector> mVectorPositions;
+	TArray<uint8> mColors;
+	TArray<FColor> mFColors;
+	TArray<int32> mSourceIds;		// The source ids of the replaying core, by recorded source id
+
+	// Snapshot batch that is collected until its last record
+	TArray<TArray<FLinearColor>> mBatchPositions;
+	TArray<TArray<uint8>> mBatchColors;
+	TArray<FPointCloudSnapshot> mBatchSnapshots;
+	int64 mBatchPointCount = 0;
+};
@@ -11,35 +11,252 @@
 
 DECLARE_STATS_GROUP(TEXT("GPUPointCloudRenderer"), STATGROUP_GPUPCR, STATCAT_Advanced);
 
+/** Space-filling curves the points can be reordered along before upload. */
+enum class EPointCloudSortOrder : uint8
+{
+	None,
+	Morton,
+	Hilbert
+};
+
+/** GPU formats of the color texture. */
+enum class EPointCloudColorFormat : uint8
+{
+	Uncompressed,
+	BC1,
+	BC7
+};
+
+/** Result of the last color block compression of FPointCloudStreamingCore. RmsError is measured on the RGB channels in 8-bit steps. */
+struct GPUPOINTCLOUDRENDERER_API FPointCloudColorCompressionStats
+{
+	int32 PointCount = 0;
+	int64 UncompressedBytes = 0;
+	int64 CompressedBytes = 0;
+	double EncodeSeconds = 0.0;
+	float RmsError = 0.f;
+
+	FString ToString() const;
+};
+
+/** A single capture (points in sensor space plus its registration) for FPointCloudStreamingCore::AddSnapshots(). */
+struct FPointCloudSnapshot
+{
+	const TArray<FLinearColor>* PointPositions = nullptr;
+	const TArray<uint8>* PointColors = nullptr;
+	FVector OffsetTranslation = FVector::ZeroVector;
+	FRotator OffsetRotation = FRotator::ZeroRotator;
+};
+
+/** Ingest filters of FPointCloudStreamingCore. All values are in the local space of the point cloud. */
+struct FPointCloudFilterSettings
+{
+	/** Keeps only points within the box. */
+	bool bCropToBox = false;
+	FBox CropBox = FBox(ForceInit);
+
+	/** Keeps only points within [MinRange, MaxRange] of the origin (e.g. the sensor position). */
+	bool bCropToRange = false;
+	FVector RangeOrigin = FVector::ZeroVector;
+	float MinRange = 0.f;
+	float MaxRange = BIG_NUMBER;
+
+	/** Statistical outlier removal: drops points whose k-th neighbour distance exceeds mean + multiplier * standard deviation. */
+	bool bRemoveOutliers = false;
+	int32 OutlierNeighbourCount = 8;
+	float OutlierStdDevMultiplier = 1.f;
+
+	bool IsActive() const { return bCropToBox || bCropToRange || bRemoveOutliers; };
+};
+
 class GPUPOINTCLOUDRENDERER_API FPointCloudStreamingCore
 {
 public:
-	FPointCloudStreamingCore(UMaterialInstanceDynamic* pointCloudShaderDynInstance = nullptr) { mDynamicMatInstance = pointCloudShaderDynInstance; };
+	FPointCloudStreamingCore(UMaterialInstanceDynamic* pointCloudShaderDynInstance = nullptr);
 	~FPointCloudStreamingCore();
 	//virtual unsigned int GetInstanceId() const { return _instanceId; };
 	unsigned int GetPointCount() { return mPointCount; };
+
+	/**
+	* The number of leading texels the base mesh has to draw (one triangle each), e.g. only the points that survived the filter.
+	* Rounded up to eighths of the texture, the texels behind the valid points repeat the last one.
+	*/
+	unsigned int GetDrawPointCount();
 	FBox GetExtent() { return mExtent; };
+	/** The set extent, otherwise the bounds of the drawn points (computed again after they were uploaded). Invalid if unknown, e.g. for shared-memory frames. */
+	FBox GetBounds();
+
+	void Update(float deltaTime);
+	void UpdateDynamicMaterialForStreaming(UMaterialInstanceDynamic* pointCloudShaderDynInstance);
 
-	void Update(float deltaTime) { UpdateShaderParameter();	mDeltaTime += deltaTime; };
-	void UpdateDynamicMaterialForStreaming(UMaterialInstanceDynamic* pointCloudShaderDynInstance) { mDynamicMatInstance = pointCloudShaderDynInstance; };
+	/**
+	* A core can feed several materials, e.g. if it is shared between several components (see IGPUPointCloudRenderer::GetSharedStreamingInstance()).
+	* The textures and point parameters are applied to all added materials, transform and appearance are left to their owners.
+	*/
+	void AddMaterialInstance(UMaterialInstanceDynamic* pointCloudShaderDynInstance);
+	void RemoveMaterialInstance(UMaterialInstanceDynamic* pointCloudShaderDynInstance) { mDynamicMatInstances.Remove(pointCloudShaderDynInstance); };
+
+	/**
+	* FAST input, the points are already packed (R = Z, G = X, B = Y, A = Z) with BGRA colors. They are copied into the upload buffers,
+	* which are reordered and padded by the ordering, progressive loading, color compression and streaming mode, so the given arrays are never modified.
+	*/
 	bool SetInput(TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors);
 	bool SetInput(TArray<FLinearColor> &pointPositions, TArray<FColor> &pointColors);
 	bool SetInput(TArray<FVector> &pointPositions, TArray<FColor> &pointColors);
 	void SetExtent(FBox extent) { mExtent = extent; };
+
+	/**
+	* Filters every following SetInput call while the points are packed into the upload buffers. Crop box and range are evaluated
+	* in the same (parallel, SIMD) pass that compacts the surviving points, outlier removal adds one compaction pass after the
+	* neighbour search. The drawn point count (see GetDrawPointCount()) follows the surviving points.
+	*/
+	void SetFilter(const FPointCloudFilterSettings &settings) { mFilter = settings; };
+	const FPointCloudFilterSettings& GetFilter() { return mFilter; };
 	void AddSnapshot(TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors, FVector offsetTranslation = FVector::ZeroVector, FRotator offsetRotation = FRotator::ZeroRotator);
 
+	/**
+	* Appends many snapshots at once, e.g. all stations of a registered scan project. The snapshots are transformed in parallel into
+	* disjoint ranges of the point buffer and uploaded once at the end. Unlike AddSnapshot(), this is not throttled by mStreamCaptureSteps.
+	* Snapshots that do not fit into the remaining capacity are skipped. Returns the number of appended snapshots.
+	*/
+	int32 AddSnapshots(const TArray<FPointCloudSnapshot> &snapshots);
+
+	/**
+	* Multi-source input, e.g. several depth cameras running at different rates. Every source gets a fixed range of texture rows,
+	* UpdateSource() converts and uploads only the rows of that source and the union of all sources is rendered.
+	* Registering a source re-lays out the texture and clears all sources. Sorting, adaptive splat sizes and progressive
+	* loading are not applied to sources, as they would mix the slots. Sources and SetInput/AddSnapshot are mutually exclusive.
+	* The unused texels of a slot repeat its last point (empty slots a point of another source), nothing is drawn until a source has points.
+	*/
+	int32 RegisterSource(int32 maxPointCount);
+	bool UpdateSource(int32 sourceId, const TArray<FLinearColor> &pointPositions, const TArray<uint8> &pointColors);
+	bool UpdateSource(int32 sourceId, const TArray<FVector> &pointPositions, const TArray<FColor> &pointColors);
+	void ClearSources();
+	int32 GetSourceCount() { return mSources.Num(); };
+
+	/**
+	* Scales every splat by the distance to its k-th nearest neighbour (relative to the average distance), so sparse regions are covered with fewer points.
+	* The scalings are computed on every input/snapshot and uploaded to the ScalingTexture.
+	*/
+	void SetAdaptiveSplatSize(bool enabled, int32 neighbourCount = 8, float minScale = 0.25f, float maxScale = 4.0f);
+
+	/**
+	* Reorders the points along a Morton or Hilbert curve within the extent before upload (colors are permuted alongside).
+	* Neighbouring splats then fetch neighbouring texels and every contiguous texel range is spatially compact.
+	* Only the upload buffers are reordered (see SetInput()).
+	*/
+	void SetSpatialOrdering(EPointCloudSortOrder order) { mSortOrder = order; };
+
+	/**
+	* Uploads SetInput/LoadArchive data progressively over the following Update() calls instead of in a single frame.
+	* The points are reordered (curve order, then bit-reversed), so every uploaded prefix is a uniform subsample of the cloud,
+	* and the drawn point count (see GetDrawPointCount()) grows in powers of two with the uploaded rows. This overrides the spatial ordering.
+	*/
+	void SetProgressiveLoading(bool enabled, int32 bytesPerFrame = 4 * 1024 * 1024);
+	bool IsProgressiveUploadPending() { return mProgressiveUploadPending; };
+
+	/**
+	* Stores the colors of static clouds (SetInput, LoadArchive) block-compressed on the GPU, BC1 at 0.5 or BC7 at 1 byte per point instead of 4.
+	* The points are sorted along the spatial curve (Morton if no ordering is set) and laid out block-linear, so every 4x4 block holds
+	* 16 neighbouring points, and the blocks are encoded on the CPU in parallel. Snapshots, sources, shared-memory streams and progressive
+	* loading keep the uncompressed texture. The block layout reorders the upload buffers only (see SetInput()).
+	*/
+	void SetColorFormat(EPointCloudColorFormat format) { mColorFormat = format; };
+	const FPointCloudColorCompressionStats& GetColorCompressionStats() { return mColorCompressionStats; };
+
+	/**
+	* Streaming mode for live sensors with fluctuating point counts. The textures and CPU buffers grow to the high-water mark of the
+	* point count and are kept, so after warm-up the ingest path neither allocates nor re-creates textures. The drawn point count is
+	* rounded up to eighths of the texture in any mode, so the base mesh is not rebuilt per input either.
+	* Both are only reduced once shrinkDelay inputs in a row would have fit into a smaller texture (or fewer eighths).
+	* GetAllocationCount() (and the Buffer Allocations stat) counts buffer reallocations and texture creations to verify this.
+	*/
+	void SetStreamingMode(bool enabled, int32 shrinkDelay = 300);
+	uint32 GetAllocationCount() { return mAllocationCount; };
+
+	/**
+	* GPU memory management (see FPointCloudMemoryManager). MarkVisible() should be called every frame the point cloud is rendered.
+	* Evicted cores release their textures but keep their CPU data, RestoreTextures() re-creates and re-uploads them.
+	*/
+	void MarkVisible();
+	void EvictTextures();
+	bool RestoreTextures();
+	bool IsEvicted() { return mEvictedTextureSize > 0; };
+
+	/**
+	* Connects to a shared-memory point stream written by an external capture process (see ThirdParty/PointCloudSharedMemory).
+	* The newest frame is uploaded in place on every Update(), without any intermediate copies.
+	* On Windows, globalNamespace has to match the namespace the producer created the segment in (Local by default).
+	*/
+	bool ConnectSharedMemory(const FString &segmentName, bool globalNamespace = false);
+	void DisconnectSharedMemory();
+	/** The maximum point count of a shared-memory frame, 0 if not connected. */
+	unsigned int GetSharedMemoryCapacity();
+
+	/**
+	* Records every following SetInput/AddSnapshot/UpdateSource call (points, colors, transforms, timestamps) to a compressed stream file.
+	* The currently registered sources are recorded first.
+	* Use FPointCloudStreamReplayer or the PointCloud.Replay console command to feed it back.
+	*/
+	bool StartRecording(const FString &filePath);
+	void StopRecording();
+	bool IsRecording() { return mRecorder != nullptr; };
+
+	/**
+	* Spatial queries in the local space of the point cloud. The index is built lazily (in parallel) on the first query after new data arrived,
+	* appended snapshots are indexed incrementally, also if the points are re-sorted (the index follows the permutation).
+	* Inputs that replace the points (SetInput, UpdateSource, LoadArchive) rebuild the whole index on the next query, as do the
+	* filters and the block layout of compressed colors, which only apply to such inputs. Results are indices into the point buffer
+	* and the respective positions. Not available for shared-memory streams, as their points never reach the CPU buffers.
+	*/
+	bool RaycastPoint(const FVector &origin, const FVector &direction, float maxDistance, float tolerance, int32 &outIndex, FVector &outPosition);
+	void FindPointsInRadius(const FVector &center, float radius, TArray<int32> &outIndices, TArray<FVector> &outPositions);
+	void FindPointsInBox(const FBox &box, TArray<int32> &outIndices, TArray<FVector> &outPositions);
+	void FindNearestPoints(const FVector &center, int32 count, TArray<int32> &outIndices, TArray<FVector> &outPositions);
+
+	/**
+	* Writes the current points to a compressed archive (see FPointCloudArchive) or loads one, decoding directly into the upload buffers.
+	* Positions are quantized to the given precision and the points are stored in Morton order.
+	*/
+	bool SaveArchive(const FString &filePath, float precision, struct FPointCloudArchiveStats* outStats = nullptr);
+	bool LoadArchive(const FString &filePath, struct FPointCloudArchiveStats* outStats = nullptr);
+
 	float mStreamCaptureSteps = 0.5f;
 	unsigned int mGlobalStreamCounter = 0;
 
 private:
-	void Initialize(unsigned int pointCount);
+	void Initialize(unsigned int pointCount, bool exactSize = false);
 	void ResetPointData(const int32 &pointsPerAxis);
+	template<typename T>
+	void ResizeBuffer(TArray<T> &buffer, int32 count);
+	void UpdateDrawPointCount();
+	void PadDrawnTexels(TArray<FLinearColor> &positions, TArray<uint8> &colors);
 	void CreateTextures(const int32 &pointsPerAxis);
+	void CreateTextureResources(const int32 &pointsPerAxis);
+	void CreateColorTexture(const int32 &pointsPerAxis, EPixelFormat format, const TArray<uint8>* blockData = nullptr);
+	void ReportResidentBytes();
+	bool CompressColors();
+	void ReleaseTextures(bool clearMaterial);
 	void InitColorBuffer();
 	void InitPointPosBuffer();
 	bool UpdateTextureBuffer();
+	bool UploadPointCloudData();
+	void UploadTextureRows(const uint8* positionData, const uint8* colorData, uint32 firstRow, uint32 numRows, const uint8* scalingData = nullptr);
+	void UploadProgressiveSlice();
+	bool ConsumeSharedMemoryFrame();
 	void UpdateShaderParameter();
 	void SortPointCloudData();
+	void ComputeAdaptiveScaling();
+	int32 AppendSnapshots(const FPointCloudSnapshot* snapshots, int32 snapshotCount);
+	bool UpdateSpatialIndex();
+	bool BuildSourceLayout();
+	template<typename PointSource>
+	void ApplyFilters(int32 pointCount, const PointSource &getPoint);
+	template<typename PointFilter>
+	int32 CompactPoints(int32 pointCount, const PointFilter &filterPoint);
+	bool BeginSourceUpdate(int32 sourceId, int32 &inOutPointCount, uint32 &outFirstPoint);
+	void EndSourceUpdate(int32 sourceId, int32 pointCount);
+	void PadSourceSlot(int32 sourceId, uint32 fillerPoint);
 	void FreeData();
 	unsigned int GetUpperPowerOfTwo(unsigned int v)
 	{
@@ -54,9 +271,15 @@ private:
 	}
 
 	// General variables
-	class UMaterialInstanceDynamic* mDynamicMatInstance = nullptr;
+	TArray<class UMaterialInstanceDynamic*> mDynamicMatInstances;
+	uint64 mLastUpdateFrame = MAX_uint64;
 	unsigned int mPointCount = 0;
+	unsigned int mValidPointCount = 0;
+	unsigned int mDrawPointCount = 0;		// >= mValidPointCount, see UpdateDrawPointCount()
 	FBox mExtent = FBox(FVector::ZeroVector, FVector::ZeroVector);
+	FBox mBounds = FBox(ForceInit);
+	bool mBoundsDirty = false;
+	TArray<FBox> mChunkBounds;
 	float mDeltaTime = 10.f;
 
 	// CPU buffers
@@ -64,16 +287,77 @@ private:
 	TArray<FLinearColor>* mPointPosDataPointer = &mPointPosData;
 	TArray<uint8> mPointColorData;
 	TArray<uint8>* mPointColorDataPointer = &mPointColorData;
-	TArray<FVector> mPointScalingData;
+	TArray<FLinearColor> mPointScalingData;
+
+	// Streaming mode variables
+	bool mStreamingMode = false;
+	int32 mShrinkDelay = 300;
+	int32 mUndersizedInputCount = 0;
+	int32 mUndersizedDrawCount = 0;
+	uint32 mAllocationCount = 0;
 
 	// GPU texture buffers
-	struct FUpdateTextureRegion2D* mUpdateTextureRegion = nullptr;
 	UTexture2D* mPointPosTexture = nullptr;
 	UTexture2D* mPointScalingTexture = nullptr;
 	UTexture2D* mPointColorTexture = nullptr;
+	int32 mEvictedTextureSize = 0;
+
+	// Shared-memory streaming variables
+	class FPointCloudSharedMemoryConsumer* mSharedMemoryConsumer = nullptr;
+
+	// Snapshot variables (kept between calls)
+	struct FSnapshotTransformJob
+	{
+		int32 Snapshot;
+		int32 Source;
+		int32 Target;
+		int32 Count;
+	};
+	TArray<FMatrix> mSnapshotMatrices;
+	TArray<FVector4> mSnapshotTranslations;
+	TArray<FSnapshotTransformJob> mSnapshotJobs;
+
+	// Filter variables
+	FPointCloudFilterSettings mFilter;
+	TArray<int32> mFilterChunkCounts;
+
+	// Multi-source variables
+	struct FSourceSlot
+	{
+		uint32 MaxPointCount = 0;
+		uint32 FirstRow = 0;
+		uint32 RowCount = 0;
+		uint32 PointCount = 0;
+	};
+	TArray<FSourceSlot> mSources;
+	uint32 mSourceTextureSize = 0;
+
+	// Color compression variables
+	EPointCloudColorFormat mColorFormat = EPointCloudColorFormat::Uncompressed;
+	EPointCloudColorFormat mCompressedColorFormat = EPointCloudColorFormat::Uncompressed;
+	TArray<uint8> mCompressedColorData;		// Blocks of the current points, kept to restore evicted textures
+	TArray<int32> mBlockLayoutIndices;
+	FPointCloudColorCompressionStats mColorCompressionStats;
+
+	// Progressive loading variables
+	bool mProgressiveLoading = false;
+	bool mProgressiveUploadPending = false;
+	int32 mProgressiveBytesPerFrame = 4 * 1024 * 1024;
+	unsigned int mProgressiveUploadedRows = 0;
+
+	// Recording-related variables
+	class FPointCloudStreamRecorder* mRecorder = nullptr;
+
+	// Spatial query variables
+	class FPointCloudSpatialIndex* mSpatialIndex = nullptr;
+	unsigned int mIndexedPointCount = 0;		// 0 invalidates the whole index
 	
 	// Sorting-related variables
 	class FComputeShader* mComputeShader = nullptr;
+	EPointCloudSortOrder mSortOrder = EPointCloudSortOrder::None;
+	class FPointCloudSpatialSorter* mSpatialSorter = nullptr;
+	TArray<FLinearColor> mSortScratchPositions;
+	TArray<uint32> mSortScratchColors;
 	class FPixelShader* mPixelShader = nullptr;
 	class FPixelShader* mPixelShader2 = nullptr;
 	class UTextureRenderTarget2D* mComputeShaderRT = nullptr;
@@ -81,5 +365,13 @@ private:
 	UTexture* mCastedRT = nullptr;
 	UTexture* mCastedColorRT = nullptr;
 
+	// Adaptive splat size variables
+	bool mUseAdaptiveSplatSize = false;
+	int32 mDensityNeighbourCount = 8;
+	float mMinSplatScale = 0.25f;
+	float mMaxSplatScale = 4.0f;
+	class FPointCloudDensityEstimator* mDensityEstimator = nullptr;
+	TArray<float> mNeighbourDistances;
+
 };
 
@@ -6,6 +6,8 @@
 #include "IGPUPointCloudRenderer.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "PointCloudStreamingCore.h"
+#include "PointCloudStreamRecorder.h"
+#include "PointCloudArchive.h"
 #include "UObject/ConstructorHelpers.h"
 
 
@@ -39,8 +41,9 @@ UGPUPointCloudRendererComponent::UGPUPointCloudRendererComponent(const FObjectIn
 }
 
 UGPUPointCloudRendererComponent::~UGPUPointCloudRendererComponent() {
-	if (mPointCloudCore)
-		delete mPointCloudCore;
+	if (mReplayer)
+		delete mReplayer;
+	ReleasePointCloudCore();
 }
 
 //////////////////////
@@ -70,8 +73,8 @@ void UGPUPointCloudRendererComponent::SetInputAndConvert1(TArray<FLinearColor> &
 		return;
 	}
 
-	CreateStreamingBaseMesh(pointPositions.Num());
 	mPointCloudCore->SetInput(pointPositions, pointColors);
+	CreateStreamingBaseMesh();
 }
 
 void UGPUPointCloudRendererComponent::AddSnapshot(TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors, FVector offsetTranslation, FRotator offsetRotation) {
@@ -85,13 +88,115 @@ void UGPUPointCloudRendererComponent::AddSnapshot(TArray<FLinearColor> &pointPos
 		return;
 	}
 
-	CreateStreamingBaseMesh(MAXTEXRES * MAXTEXRES);
-
 	// Since the point is later transformed to the local coordinate system, we have to inverse transform it beforehand
 	FMatrix objMatrix = this->GetComponentToWorld().ToMatrixWithScale();
 	offsetTranslation = objMatrix.InverseTransformVector(offsetTranslation);
 
 	mPointCloudCore->AddSnapshot(pointPositions, pointColors, offsetTranslation, offsetRotation);
+	CreateStreamingBaseMesh();
+}
+
+int32 UGPUPointCloudRendererComponent::AddSnapshots(const TArray<FPointCloudSnapshotData> &snapshots) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return 0;
+	}
+
+	// Since the points are later transformed to the local coordinate system, we have to inverse transform the offsets beforehand
+	FMatrix objMatrix = this->GetComponentToWorld().ToMatrixWithScale();
+	TArray<FPointCloudSnapshot> coreSnapshots;
+	coreSnapshots.Reserve(snapshots.Num());
+	for (const FPointCloudSnapshotData &data : snapshots) {
+
+		if (data.PointPositions.Num() * 4 != data.PointColors.Num())
+			UE_LOG(GPUPointCloudRenderer, Warning, TEXT("The number of point positions doesn't match the number of point colors."));
+
+		FPointCloudSnapshot &snapshot = coreSnapshots.AddDefaulted_GetRef();
+		snapshot.PointPositions = &data.PointPositions;
+		snapshot.PointColors = &data.PointColors;
+		snapshot.OffsetTranslation = objMatrix.InverseTransformVector(data.OffsetTranslation);
+		snapshot.OffsetRotation = data.OffsetRotation;
+	}
+
+	const int32 addedSnapshots = mPointCloudCore->AddSnapshots(coreSnapshots);
+	CreateStreamingBaseMesh();
+	if (addedSnapshots < snapshots.Num())
+		UE_LOG(GPUPointCloudRenderer, Warning, TEXT("Only %d of %d snapshots could be added (empty or exceeding the capacity of %d points)."), addedSnapshots, snapshots.Num(), MAXTEXRES * MAXTEXRES);
+	return addedSnapshots;
+}
+
+int32 UGPUPointCloudRendererComponent::RegisterPointSource(int32 maxPointCount) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return INDEX_NONE;
+	}
+
+	const int32 sourceId = mPointCloudCore->RegisterSource(maxPointCount);
+	if (sourceId == INDEX_NONE) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not register a point source with %d points (the total capacity is %d points)."), maxPointCount, MAXTEXRES * MAXTEXRES);
+		return INDEX_NONE;
+	}
+
+	CreateStreamingBaseMesh();
+	return sourceId;
+}
+
+bool UGPUPointCloudRendererComponent::UpdatePointSource(int32 sourceId, TArray<FVector> &pointPositions, TArray<FColor> &pointColors) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	if (pointPositions.Num() != pointColors.Num())
+		UE_LOG(GPUPointCloudRenderer, Warning, TEXT("The number of point positions doesn't match the number of point colors."));
+
+	return mPointCloudCore->UpdateSource(sourceId, pointPositions, pointColors);
+}
+
+bool UGPUPointCloudRendererComponent::UpdatePointSourceFast(int32 sourceId, TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	if (pointPositions.Num() * 4 != pointColors.Num())
+		UE_LOG(GPUPointCloudRenderer, Warning, TEXT("The number of point positions doesn't match the number of point colors."));
+
+	return mPointCloudCore->UpdateSource(sourceId, pointPositions, pointColors);
+}
+
+void UGPUPointCloudRendererComponent::ClearPointSources() {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->ClearSources();
+}
+
+void UGPUPointCloudRendererComponent::SetInputFilter(bool cropToBox, FBox cropBox, bool cropToRange, float minRange, float maxRange, bool removeOutliers, int32 outlierNeighbourCount, float outlierStdDevMultiplier) {
+
+	CHECK_PCR_STATUS
+
+	FPointCloudFilterSettings filter;
+	filter.bCropToBox = cropToBox;
+	filter.CropBox = cropBox;
+	filter.bCropToRange = cropToRange;
+	filter.MinRange = minRange;
+	filter.MaxRange = maxRange;
+	filter.bRemoveOutliers = removeOutliers;
+	filter.OutlierNeighbourCount = outlierNeighbourCount;
+	filter.OutlierStdDevMultiplier = outlierStdDevMultiplier;
+	mPointCloudCore->SetFilter(filter);
+}
+
+void UGPUPointCloudRendererComponent::ClearInputFilter() {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetFilter(FPointCloudFilterSettings());
 }
 
 void UGPUPointCloudRendererComponent::SetInput(TArray<FLinearColor> &pointPositions, TArray<uint8> &pointColors) {
@@ -105,8 +210,8 @@ void UGPUPointCloudRendererComponent::SetInput(TArray<FLinearColor> &pointPositi
 		return;
 	}
 
-	CreateStreamingBaseMesh(pointPositions.Num());
 	mPointCloudCore->SetInput(pointPositions, pointColors);
+	CreateStreamingBaseMesh();
 }
 
 void UGPUPointCloudRendererComponent::SetInputAndConvert2(TArray<FVector> &pointPositions, TArray<FColor> &pointColors) {
@@ -120,8 +225,8 @@ void UGPUPointCloudRendererComponent::SetInputAndConvert2(TArray<FVector> &point
 		return;
 	}
 
-	CreateStreamingBaseMesh(pointPositions.Num());
 	mPointCloudCore->SetInput(pointPositions, pointColors);
+	CreateStreamingBaseMesh();
 }
 
 void UGPUPointCloudRendererComponent::SetExtent(FBox extent) {
@@ -132,6 +237,268 @@ void UGPUPointCloudRendererComponent::SetExtent(FBox extent) {
 	mExtent = extent.ToString();
 }
 
+void UGPUPointCloudRendererComponent::SetAdaptiveSplatSize(bool enabled, int32 neighbourCount, float minScale, float maxScale) {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetAdaptiveSplatSize(enabled, neighbourCount, minScale, maxScale);
+}
+
+void UGPUPointCloudRendererComponent::SetSpatialOrdering(EPointCloudSpatialOrdering ordering) {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetSpatialOrdering((EPointCloudSortOrder)ordering);
+}
+
+void UGPUPointCloudRendererComponent::SetProgressiveLoading(bool enabled, int32 bytesPerFrame) {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetProgressiveLoading(enabled, bytesPerFrame);
+}
+
+void UGPUPointCloudRendererComponent::SetStreamingMode(bool enabled, int32 shrinkDelay) {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetStreamingMode(enabled, shrinkDelay);
+}
+
+void UGPUPointCloudRendererComponent::SetColorCompression(EPointCloudColorCompression compression) {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->SetColorFormat((EPointCloudColorFormat)compression);
+}
+
+bool UGPUPointCloudRendererComponent::GetColorCompressionStats(float &encodeMilliseconds, float &megaPointsPerSecond, float &rmsError, int32 &compressedBytes) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	const FPointCloudColorCompressionStats &stats = mPointCloudCore->GetColorCompressionStats();
+	if (stats.PointCount == 0)
+		return false;
+
+	encodeMilliseconds = stats.EncodeSeconds * 1000.0;
+	megaPointsPerSecond = stats.EncodeSeconds > 0.0 ? stats.PointCount / stats.EncodeSeconds / 1000000.0 : 0.f;
+	rmsError = stats.RmsError;
+	compressedBytes = (int32)stats.CompressedBytes;
+	UE_LOG(GPUPointCloudRenderer, Log, TEXT("Color compression: %s"), *stats.ToString());
+	return true;
+}
+
+bool UGPUPointCloudRendererComponent::ConnectSharedMemoryStream(FString segmentName, bool globalNamespace) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	if (!mPointCloudCore->ConnectSharedMemory(segmentName, globalNamespace)) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not connect to shared memory segment %s."), *segmentName);
+		return false;
+	}
+
+	return true;
+}
+
+void UGPUPointCloudRendererComponent::DisconnectSharedMemoryStream() {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->DisconnectSharedMemory();
+}
+
+bool UGPUPointCloudRendererComponent::StartRecording(FString filePath) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	if (!mPointCloudCore->StartRecording(filePath)) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not create the recording file %s."), *filePath);
+		return false;
+	}
+	return true;
+}
+
+void UGPUPointCloudRendererComponent::StopRecording() {
+
+	CHECK_PCR_STATUS
+
+	mPointCloudCore->StopRecording();
+}
+
+bool UGPUPointCloudRendererComponent::ReplayRecording(FString filePath, bool realTime) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	if (!mReplayer)
+		mReplayer = new FPointCloudStreamReplayer();
+	if (!mReplayer->Open(filePath)) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not open the recording %s."), *filePath);
+		return false;
+	}
+	mReplayTime = 0.0;
+
+	// Real-time playback continues in TickComponent()
+	if (realTime)
+		return true;
+
+	FPointCloudReplayStats stats;
+	mReplayer->ReplayAll(*mPointCloudCore, false, stats);
+	mReplayer->Close();
+	CreateStreamingBaseMesh();
+	UE_LOG(GPUPointCloudRenderer, Log, TEXT("Replayed %s: %s"), *filePath, *stats.ToString());
+	return true;
+}
+
+bool UGPUPointCloudRendererComponent::PickPoint(FVector rayOrigin, FVector rayDirection, float maxDistance, float tolerance, int32 &pointIndex, FVector &hitLocation) {
+
+	pointIndex = INDEX_NONE;
+	hitLocation = FVector::ZeroVector;
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	// Query in local space. The tolerance is scaled conservatively, the hit is verified in world space
+	const FTransform transform = GetPointCloudTransform();
+	const float minScale = FMath::Max(transform.GetScale3D().GetAbsMin(), KINDA_SMALL_NUMBER);
+	const float maxScale = FMath::Max(transform.GetScale3D().GetAbsMax(), KINDA_SMALL_NUMBER);
+	const FVector localOrigin = transform.InverseTransformPosition(rayOrigin);
+	const FVector localEnd = transform.InverseTransformPosition(rayOrigin + rayDirection.GetSafeNormal() * maxDistance);
+	const FVector localDirection = localEnd - localOrigin;
+
+	FVector localHit;
+	if (!mPointCloudCore->RaycastPoint(localOrigin, localDirection, localDirection.Size(), tolerance / minScale, pointIndex, localHit)) {
+		pointIndex = INDEX_NONE;
+		return false;
+	}
+
+	hitLocation = transform.TransformPosition(localHit);
+	if (maxScale / minScale > 1.f + KINDA_SMALL_NUMBER && FMath::PointDistToLine(hitLocation, rayDirection, rayOrigin) > tolerance) {
+		pointIndex = INDEX_NONE;
+		return false;
+	}
+	return true;
+}
+
+void UGPUPointCloudRendererComponent::GetPointsInRadius(FVector center, float radius, TArray<int32> &pointIndices, TArray<FVector> &pointLocations) {
+
+	pointIndices.Reset();
+	pointLocations.Reset();
+	CHECK_PCR_STATUS
+
+	const FTransform transform = GetPointCloudTransform();
+	const float minScale = FMath::Max(transform.GetScale3D().GetAbsMin(), KINDA_SMALL_NUMBER);
+	mPointCloudCore->FindPointsInRadius(transform.InverseTransformPosition(center), radius / minScale, pointIndices, pointLocations);
+	LocalToWorldPoints(pointLocations);
+
+	// Non-uniform scaling: the local query was a conservative sphere
+	const float radiusSq = radius * radius;
+	for (int32 i = pointLocations.Num() - 1; i >= 0; --i) {
+		if (FVector::DistSquared(pointLocations[i], center) > radiusSq) {
+			pointLocations.RemoveAtSwap(i, 1, false);
+			pointIndices.RemoveAtSwap(i, 1, false);
+		}
+	}
+}
+
+void UGPUPointCloudRendererComponent::GetPointsInBox(FBox box, TArray<int32> &pointIndices, TArray<FVector> &pointLocations) {
+
+	pointIndices.Reset();
+	pointLocations.Reset();
+	CHECK_PCR_STATUS
+
+	// The local bounds of the rotated box are conservative, the result is filtered in world space
+	const FTransform transform = GetPointCloudTransform();
+	mPointCloudCore->FindPointsInBox(box.InverseTransformBy(transform), pointIndices, pointLocations);
+	LocalToWorldPoints(pointLocations);
+
+	for (int32 i = pointLocations.Num() - 1; i >= 0; --i) {
+		if (!box.IsInsideOrOn(pointLocations[i])) {
+			pointLocations.RemoveAtSwap(i, 1, false);
+			pointIndices.RemoveAtSwap(i, 1, false);
+		}
+	}
+}
+
+void UGPUPointCloudRendererComponent::GetNearestPoints(FVector center, int32 count, TArray<int32> &pointIndices, TArray<FVector> &pointLocations) {
+
+	pointIndices.Reset();
+	pointLocations.Reset();
+	CHECK_PCR_STATUS
+
+	// Exact for uniform scaling, which is what the point cloud shader assumes anyway
+	const FTransform transform = GetPointCloudTransform();
+	mPointCloudCore->FindNearestPoints(transform.InverseTransformPosition(center), count, pointIndices, pointLocations);
+	LocalToWorldPoints(pointLocations);
+}
+
+bool UGPUPointCloudRendererComponent::SavePointCloudArchive(FString filePath, float precision) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	FPointCloudArchiveStats stats;
+	if (!mPointCloudCore->SaveArchive(filePath, precision, &stats)) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not write the point cloud archive %s."), *filePath);
+		return false;
+	}
+	UE_LOG(GPUPointCloudRenderer, Log, TEXT("Saved %s: %s"), *filePath, *stats.ToString());
+	return true;
+}
+
+bool UGPUPointCloudRendererComponent::LoadPointCloudArchive(FString filePath) {
+
+	if (!mPointCloudCore) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Core component not found!"));
+		return false;
+	}
+
+	FPointCloudArchiveStats stats;
+	if (!mPointCloudCore->LoadArchive(filePath, &stats)) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Could not read the point cloud archive %s."), *filePath);
+		return false;
+	}
+	CreateStreamingBaseMesh();
+	UE_LOG(GPUPointCloudRenderer, Log, TEXT("Loaded %s: %s"), *filePath, *stats.ToString());
+	return true;
+}
+
+void UGPUPointCloudRendererComponent::UseSharedPointCloudData(FName dataName) {
+
+	if (!IGPUPointCloudRenderer::IsAvailable()) {
+		UE_LOG(GPUPointCloudRenderer, Error, TEXT("Point Cloud Renderer module not loaded!"));
+		return;
+	}
+
+	ReleasePointCloudCore();
+
+	if (dataName.IsNone()) {
+		mPointCloudCore = IGPUPointCloudRenderer::Get().CreateStreamingInstance(mPointCloudMaterial);
+	}
+	else {
+		mSharedPointCloudCore = IGPUPointCloudRenderer::Get().GetSharedStreamingInstance(dataName);
+		mPointCloudCore = mSharedPointCloudCore.Get();
+		mPointCloudCore->AddMaterialInstance(mPointCloudMaterial);
+	}
+
+	// The base mesh follows the point count of the (shared) data
+	CreateStreamingBaseMesh();
+}
+
 //////////////////////////
 // STANDARD FUNCTIONS ////
 //////////////////////////
@@ -141,10 +508,33 @@ void UGPUPointCloudRendererComponent::TickComponent(float DeltaTime, ELevelTick
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	// Real-time playback of a recording
+	if (mPointCloudCore && mReplayer && mReplayer->IsOpen()) {
+		mReplayTime += DeltaTime;
+		if (!mReplayer->ReplayUntil(*mPointCloudCore, mReplayTime)) {
+			UE_LOG(GPUPointCloudRenderer, Log, TEXT("Replay finished: %s"), *mReplayer->GetStats().ToString());
+			mReplayer->Close();
+		}
+	}
+
 	// Update core
 	if (mPointCloudCore) {
+		// Visible point clouds are protected from (and restored after) eviction by the memory manager.
+		// The mesh is only rendered if its bounds (the bounds of the points) are in view, see UpdateMeshBounds()
+		if (mBaseMesh && mBaseMesh->WasRecentlyRendered(0.2f))
+			mPointCloudCore->MarkVisible();
 		mPointCloudCore->Update(DeltaTime);
 		mPointCount = mPointCloudCore->GetPointCount();
+
+		// Streams, replays and shared data change the drawn point count outside of the input functions
+		CreateStreamingBaseMesh();
+
+		// The bounds follow changed points and transforms with a short delay
+		mBoundsAge += DeltaTime;
+		if (mBoundsAge >= 0.2f) {
+			mBoundsAge = 0.f;
+			UpdateMeshBounds();
+		}
 	}
 
 	// Update shader properties
@@ -156,44 +546,73 @@ void UGPUPointCloudRendererComponent::BeginPlay() {
 
 }
 
+void UGPUPointCloudRendererComponent::OnComponentDestroyed(bool bDestroyingHierarchy) {
+
+	// Stop shared data from updating the material of this component, which may be collected before the destructor runs
+	if (mSharedPointCloudCore.IsValid())
+		mSharedPointCloudCore->RemoveMaterialInstance(mPointCloudMaterial);
+
+	Super::OnComponentDestroyed(bDestroyingHierarchy);
+}
+
 
 ////////////////////////
 // HELPER FUNCTIONS ////
 ////////////////////////
 
 
-void UGPUPointCloudRendererComponent::CreateStreamingBaseMesh(int32 pointCount)
+void UGPUPointCloudRendererComponent::CreateStreamingBaseMesh()
 {
 	CHECK_PCR_STATUS
 
-	// Dirty fix: Avoid recreation of point cloud mesh every frame
-	int32 pointsPerAxis = FMath::CeilToInt(FMath::Sqrt(pointCount));
-	if (pointsPerAxis % 2 == 1) pointsPerAxis++;
-	pointsPerAxis = GetUpperPowerOfTwo(pointsPerAxis);
-	auto totalPointCount = pointsPerAxis* pointsPerAxis;
+	// One triangle per drawn texel, the texels behind the drawn point count of the core are never drawn
+	const int32 pointCount = mPointCloudCore->GetDrawPointCount();
 
 	//Check if update is neccessary
-	if (mBaseMesh && mPointCount == totalPointCount)
+	if (mBaseMesh && mMeshPointCount == pointCount)
 		return;
-	if (pointCount == 0 || !mPointCloudCore)
+	if (!mBaseMesh && pointCount == 0)
 		return;
 
-	mBaseMesh = NewObject<UPointCloudMeshComponent>(this, FName("PointCloud Mesh"));
-
 	// Create base mesh
 	TArray<FCustomMeshTriangle> triangles;
 	BuildTriangleStack(triangles, pointCount);
+	mMeshPointCount = pointCount;
+
+	// An existing mesh keeps its component and material, only the triangles are replaced
+	if (mBaseMesh) {
+		mBaseMesh->SetCustomMeshTriangles(triangles);
+		return;
+	}
+
+	mBaseMesh = NewObject<UPointCloudMeshComponent>(this, FName("PointCloud Mesh"));
 	mBaseMesh->SetCustomMeshTriangles(triangles);
 	mBaseMesh->RegisterComponent();
 	mBaseMesh->AttachToComponent(this, FAttachmentTransformRules::KeepRelativeTransform);
 	mBaseMesh->SetMaterial(0, mStreamingBaseMat);
 	mBaseMesh->SetAbsolute(false, true, true);	// Disable scaling for the mesh - the scaling vector is transferred via a shader parameter in UpdateShaderProperties()
 	mBaseMesh->bNeverDistanceCull = true;
-	//mBaseMesh->SetCustomBounds(mPointCloudCore->GetExtent());
+	UpdateMeshBounds();
 
 	// Update material
+	mPointCloudCore->RemoveMaterialInstance(mPointCloudMaterial);
 	mPointCloudMaterial = mBaseMesh->CreateAndSetMaterialInstanceDynamic(0);
-	mPointCloudCore->UpdateDynamicMaterialForStreaming(mPointCloudMaterial);
+	mPointCloudCore->AddMaterialInstance(mPointCloudMaterial);
+}
+
+void UGPUPointCloudRendererComponent::UpdateMeshBounds()
+{
+	if (!mBaseMesh || !mPointCloudCore)
+		return;
+
+	// The material places the points with the point cloud transform, the mesh itself is not rotated or scaled
+	const FBox bounds = mPointCloudCore->GetBounds();
+	if (!bounds.IsValid) {
+		mBaseMesh->ClearCustomBounds();
+		return;
+	}
+	const FBox worldBounds = bounds.TransformBy(GetPointCloudTransform()).ExpandBy(mSplatSize);
+	mBaseMesh->SetCustomBounds(worldBounds.InverseTransformBy(mBaseMesh->GetComponentTransform()));
 }
 
 void UGPUPointCloudRendererComponent::BuildTriangleStack(TArray<FCustomMeshTriangle> &triangles, const int32 &pointCount)
@@ -221,6 +640,31 @@ void UGPUPointCloudRendererComponent::BuildTriangleStack(TArray<FCustomMeshTrian
 	}
 }
 
+FTransform UGPUPointCloudRendererComponent::GetPointCloudTransform() const
+{
+	// Matches the transformation applied in the point cloud material (see UpdateShaderProperties())
+	return FTransform(GetComponentRotation(), GetComponentLocation(), GetComponentScale() * mCloudScaling);
+}
+
+void UGPUPointCloudRendererComponent::LocalToWorldPoints(TArray<FVector> &pointLocations) const
+{
+	const FTransform transform = GetPointCloudTransform();
+	for (FVector &location : pointLocations)
+		location = transform.TransformPosition(location);
+}
+
+void UGPUPointCloudRendererComponent::ReleasePointCloudCore()
+{
+	if (mSharedPointCloudCore.IsValid()) {
+		mSharedPointCloudCore->RemoveMaterialInstance(mPointCloudMaterial);
+		mSharedPointCloudCore.Reset();
+	}
+	else if (mPointCloudCore) {
+		delete mPointCloudCore;
+	}
+	mPointCloudCore = nullptr;
+}
+
 void UGPUPointCloudRendererComponent::UpdateShaderProperties()
 {
 	if (!mPointCloudMaterial)
@@ -12,23 +12,70 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(GPUPointCloudRenderer, Log, All);
 
+UENUM(BlueprintType)
+enum class EPointCloudSpatialOrdering : uint8
+{
+	None,
+	Morton,
+	Hilbert
+};
+
+UENUM(BlueprintType)
+enum class EPointCloudColorCompression : uint8
+{
+	None,
+	BC1,
+	BC7
+};
+
+/** A single capture for "PCR Add Point Cloud Snapshots". */
+USTRUCT(BlueprintType)
+struct FPointCloudSnapshotData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GPUPointCloudRenderer")
+	TArray<FLinearColor> PointPositions;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GPUPointCloudRenderer")
+	TArray<uint8> PointColors;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GPUPointCloudRenderer")
+	FVector OffsetTranslation = FVector::ZeroVector;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GPUPointCloudRenderer")
+	FRotator OffsetRotation = FRotator::ZeroRotator;
+};
+
 UCLASS(ClassGroup = Rendering, meta = (BlueprintSpawnableComponent), hideCategories = (Object, LOD, Physics, Collision))
 class GPUPOINTCLOUDRENDEREREDITOR_API UPointCloudMeshComponent : public UCustomMeshComponent
 {	
 	GENERATED_BODY()
 
 public:
+	/** Bounds in component space. */
 	bool SetCustomBounds(FBox boundingBox) { 
 
-		if (boundingBox.Min == FVector::ZeroVector && boundingBox.Max == FVector::ZeroVector)
+		if (!boundingBox.IsValid || (boundingBox.Min == FVector::ZeroVector && boundingBox.Max == FVector::ZeroVector))
 			return false;
+		if (mUseCustomBounds && mCustomBounds == boundingBox)
+			return true;
 
 		mCustomBounds = boundingBox;
 		mUseCustomBounds = true;
+		UpdateBounds();
+		MarkRenderTransformDirty();
 
 		return true;
 	}
 
+	void ClearCustomBounds() {
+
+		if (!mUseCustomBounds)
+			return;
+
+		mUseCustomBounds = false;
+		UpdateBounds();
+		MarkRenderTransformDirty();
+	}
+
 private:
 	//~ Begin USceneComponent Interface.
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override {
@@ -36,10 +83,7 @@ private:
 		FBoxSphereBounds NewBounds;
 
 		if (mUseCustomBounds) {
-			NewBounds.Origin = mCustomBounds.GetCenter();
-			NewBounds.BoxExtent = mCustomBounds.GetExtent();
-			float r = NewBounds.BoxExtent.GetMax();
-			NewBounds.SphereRadius = FMath::Sqrt(3.0f*r);
+			NewBounds = FBoxSphereBounds(mCustomBounds).TransformBy(LocalToWorld);
 		}
 		else {
 			NewBounds.Origin = this->GetComponentToWorld().GetLocation();
@@ -99,6 +143,7 @@ public:
 	Green Channel : X-values;
 	Blue Channel : Y-values;
 	Red Channel : Z-values;
+	* The arrays are copied for the upload, so they are never reordered or resized by the renderer.
 	*
 	* @param	pointPositions				Array of your point positions. Please mind the mapping: Alpha Channel : Z-values, Green Channel : X-values, Blue Channel : Y-values, Red Channel : Z-values.
 	* @param	pointColors					Array of your point colors (BGRA-encoded).
@@ -123,6 +168,27 @@ public:
 	UFUNCTION(DisplayName = "PCR Set Extent", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "set extent point cloud"))
 	void SetExtent(FBox extent);
 
+	/**
+	* Sets the filters applied to all following inputs while they are packed for rendering, instead of filtering the arrays in Blueprint beforehand. All values are in the local space of the point cloud, the range is measured from its origin (the sensor).
+	*
+	* @param	cropToBox					Keep only points within the crop box.
+	* @param	cropBox						The crop box (region of interest).
+	* @param	cropToRange					Keep only points within the min/max range.
+	* @param	minRange					The minimum distance to the origin.
+	* @param	maxRange					The maximum distance to the origin.
+	* @param	removeOutliers				Enables statistical outlier removal.
+	* @param	outlierNeighbourCount		The number of neighbours (k) for the outlier statistics.
+	* @param	outlierStdDevMultiplier		Points whose k-th neighbour distance exceeds the mean by more than this many standard deviations are removed.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Input Filter", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "filter crop box range clip outlier removal noise point cloud"))
+	void SetInputFilter(bool cropToBox, FBox cropBox, bool cropToRange = false, float minRange = 0.f, float maxRange = 100000.f, bool removeOutliers = false, int32 outlierNeighbourCount = 8, float outlierStdDevMultiplier = 1.0f);
+
+	/**
+	* Disables all input filters.
+	*/
+	UFUNCTION(DisplayName = "PCR Clear Input Filter", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "filter crop range outlier clear disable point cloud"))
+	void ClearInputFilter();
+
 	/**
 	* Creates a large datasets and adds the given data as a "snapshot" to it. Can be used to collect different point cloud datasets into one large set (e.g. collecting a 360�-View with several captures of the environment etc.).
 	*
@@ -134,8 +200,223 @@ public:
 	UFUNCTION(DisplayName = "PCR Add Point Cloud Snapshot", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "set add input increment point cloud collect snapshot kinect"))
 	void AddSnapshot(UPARAM(ref) TArray<FLinearColor> &pointPositions, UPARAM(ref) TArray<uint8> &pointColors, FVector offsetTranslation = FVector::ZeroVector, FRotator offsetRotation = FRotator::ZeroRotator);
 
+	/**
+	* Adds many snapshots at once (e.g. all stations of a registered scan project). The snapshots are transformed in parallel and uploaded once, which is much faster than calling "PCR Add Point Cloud Snapshot" for each of them. Snapshots that exceed the remaining capacity are skipped.
+	*
+	* @param	snapshots					The snapshots with their World-Space offset translations and rotations.
+	*/
+	UFUNCTION(DisplayName = "PCR Add Point Cloud Snapshots", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "add batch import scan project stations point cloud collect snapshots"))
+	int32 AddSnapshots(const TArray<FPointCloudSnapshotData> &snapshots);
+
+	/**
+	* Reserves a fixed part of the point cloud for one input source (e.g. one of several depth cameras). Each source is then updated separately with "PCR Update Point Source" and only its own part is converted and uploaded, the union of all sources is rendered. Registering a source clears the data of all sources.
+	*
+	* @param	maxPointCount				The maximum number of points this source delivers per frame.
+	* @return								The id of the source or -1 if the capacity is exceeded.
+	*/
+	UFUNCTION(DisplayName = "PCR Register Point Source", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "register source sensor camera multi fuse kinect"))
+	int32 RegisterPointSource(int32 maxPointCount);
+
+	/**
+	* Updates the points of a single source. Points beyond the registered maximum of the source are dropped.
+	*
+	* @param	sourceId					The id returned by "PCR Register Point Source".
+	* @param	pointPositions				Array of the point positions of this source.
+	* @param	pointColors					Array of the point colors of this source.
+	*/
+	UFUNCTION(DisplayName = "PCR Update Point Source (FVector/FColor)", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "update source sensor camera multi fuse kinect input"))
+	bool UpdatePointSource(int32 sourceId, UPARAM(ref) TArray<FVector> &pointPositions, UPARAM(ref) TArray<FColor> &pointColors);
+
+	/**
+	* Updates the points of a single source with data that is already in the packed layout (see "PCR Set/Stream Input FAST").
+	*
+	* @param	sourceId					The id returned by "PCR Register Point Source".
+	* @param	pointPositions				Array of the point positions of this source.
+	* @param	pointColors					Array of the point colors of this source (4 bytes per point).
+	*/
+	UFUNCTION(DisplayName = "PCR Update Point Source FAST", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "update source sensor camera multi fuse kinect input fast"))
+	bool UpdatePointSourceFast(int32 sourceId, UPARAM(ref) TArray<FLinearColor> &pointPositions, UPARAM(ref) TArray<uint8> &pointColors);
+
+	/**
+	* Removes all point sources.
+	*/
+	UFUNCTION(DisplayName = "PCR Clear Point Sources", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "clear remove source sensor camera multi"))
+	void ClearPointSources();
+
+	/**
+	* Enables density-adaptive splat sizes. Every splat is scaled by the distance to its k-th nearest neighbour, so sparse regions get larger splats and need fewer points for the same coverage. Requires the material to read the ScalingTexture.
+	*
+	* @param	enabled						Enables or disables the adaptive splat sizes.
+	* @param	neighbourCount				The number of neighbours (k) used for the density estimation.
+	* @param	minScale					The minimum splat scaling factor.
+	* @param	maxScale					The maximum splat scaling factor.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Adaptive Splat Size", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "adaptive splat size density scaling point cloud"))
+	void SetAdaptiveSplatSize(bool enabled = true, int32 neighbourCount = 8, float minScale = 0.25f, float maxScale = 4.0f);
+
+	/**
+	* Reorders the points along a space-filling curve before they are uploaded. Improves the texture cache locality during rendering.
+	*
+	* @param	ordering					The space-filling curve (Morton or Hilbert) or None to keep the given order.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Spatial Ordering", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "sort order morton hilbert spatial point cloud"))
+	void SetSpatialOrdering(EPointCloudSpatialOrdering ordering = EPointCloudSpatialOrdering::Morton);
+
+	/**
+	* Enables progressive loading: following inputs are uploaded in row slices over several frames instead of at once, starting with a uniform subsample of the whole cloud that refines as more slices arrive. Only the uploaded points are drawn.
+	*
+	* @param	enabled						Enables or disables progressive loading.
+	* @param	bytesPerFrame				The maximum number of bytes uploaded per frame.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Progressive Loading", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "progressive loading refinement budget upload hitch point cloud"))
+	void SetProgressiveLoading(bool enabled = true, int32 bytesPerFrame = 4194304);
+
+	/**
+	* Enables the streaming mode for live sensors with fluctuating point counts: buffers and textures are kept at the largest size seen so far, so the streaming inputs stop allocating memory and re-creating textures after a short warm-up. The point mesh is sized in eighths of the texture, so it is not rebuilt for every input either. The Buffer Allocations stat shows the remaining allocations.
+	*
+	* @param	enabled						Enables or disables the streaming mode.
+	* @param	shrinkDelay					The number of inputs in a row that have to fit into a smaller texture before the memory is released.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Streaming Mode", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "streaming live sensor allocation memory hysteresis capacity point cloud"))
+	void SetStreamingMode(bool enabled = true, int32 shrinkDelay = 300);
+
+	/**
+	* Block-compresses the colors of following static inputs (Set Input, Load Point Cloud Archive) on the GPU: BC1 needs 0.5, BC7 1 byte per point instead of 4. The points are reordered spatially for this. Not applied to snapshots, sources, shared-memory streams and progressive loading.
+	*
+	* @param	compression					The color compression or None for uncompressed colors.
+	*/
+	UFUNCTION(DisplayName = "PCR Set Color Compression", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "color compression bc1 bc7 dxt block memory static scan point cloud"))
+	void SetColorCompression(EPointCloudColorCompression compression = EPointCloudColorCompression::BC1);
+
+	/**
+	* Returns (and logs) the results of the last color compression.
+	*
+	* @param	encodeMilliseconds			The encoding time.
+	* @param	megaPointsPerSecond			The encoding throughput.
+	* @param	rmsError					The RMS color error in 8-bit steps.
+	* @param	compressedBytes				The size of the compressed color texture.
+	*/
+	UFUNCTION(DisplayName = "PCR Get Color Compression Stats", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "color compression stats error throughput bc1 bc7 point cloud"))
+	bool GetColorCompressionStats(float &encodeMilliseconds, float &megaPointsPerSecond, float &rmsError, int32 &compressedBytes);
+
+	/**
+	* Connects the renderer to a shared-memory point stream of an external capture process (e.g. a sensor driver using the PointCloudSharedMemory producer library). The newest frame is rendered every tick without copying it through Blueprint arrays.
+	*
+	* @param	segmentName					The name of the shared-memory segment the producer created.
+	* @param	globalNamespace				Windows only: whether the producer created the segment in the Global instead of the Local (session) namespace.
+	* @return								True if the segment was found and is valid.
+	*/
+	UFUNCTION(DisplayName = "PCR Connect Shared Memory Stream", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "shared memory ipc stream sensor kinect connect"))
+	bool ConnectSharedMemoryStream(FString segmentName = "PointCloudStream", bool globalNamespace = false);
+
+	/**
+	* Disconnects the renderer from the shared-memory point stream.
+	*/
+	UFUNCTION(DisplayName = "PCR Disconnect Shared Memory Stream", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "shared memory ipc stream sensor kinect disconnect"))
+	void DisconnectSharedMemoryStream();
+
+	/**
+	* Starts recording every following input/snapshot call of this component (points, colors, transforms and timestamps) to a compressed stream file.
+	*
+	* @param	filePath					The file the stream is written to.
+	*/
+	UFUNCTION(DisplayName = "PCR Start Recording", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "record stream capture benchmark point cloud"))
+	bool StartRecording(FString filePath);
+
+	/**
+	* Stops the recording and flushes the stream file.
+	*/
+	UFUNCTION(DisplayName = "PCR Stop Recording", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "record stream capture benchmark point cloud stop"))
+	void StopRecording();
+
+	/**
+	* Replays a recorded stream into this component. In real-time mode, the stream is played back with its recorded timing during the following ticks. Otherwise, the whole stream is ingested immediately as fast as possible and the throughput and latency are logged.
+	*
+	* @param	filePath					The recorded stream file.
+	* @param	realTime					Whether to replay with the recorded timing or at maximum speed.
+	*/
+	UFUNCTION(DisplayName = "PCR Replay Recording", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "replay stream recording benchmark point cloud"))
+	bool ReplayRecording(FString filePath, bool realTime = true);
+
+	/**
+	* Finds the first point hit by the given ray (world space). Points count as hit if they are within the given tolerance to the ray.
+	* The first query after new input builds the spatial index, appended snapshots only extend it. Every other input rebuilds it.
+	*
+	* @param	rayOrigin					The ray origin in world space.
+	* @param	rayDirection				The ray direction in world space.
+	* @param	maxDistance					The maximum distance along the ray.
+	* @param	tolerance					The maximum distance of a point to the ray (world units), e.g. the splat size.
+	* @param	pointIndex					The index of the hit point.
+	* @param	hitLocation					The world location of the hit point.
+	*/
+	UFUNCTION(DisplayName = "PCR Pick Point", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "pick raycast trace select point cloud"))
+	bool PickPoint(FVector rayOrigin, FVector rayDirection, float maxDistance, float tolerance, int32 &pointIndex, FVector &hitLocation);
+
+	/**
+	* Returns all points within the given sphere (world space).
+	*
+	* @param	center						The sphere center in world space.
+	* @param	radius						The sphere radius in world units.
+	* @param	pointIndices				The indices of the found points.
+	* @param	pointLocations				The world locations of the found points.
+	*/
+	UFUNCTION(DisplayName = "PCR Get Points In Radius", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "query radius sphere overlap neighbours point cloud"))
+	void GetPointsInRadius(FVector center, float radius, TArray<int32> &pointIndices, TArray<FVector> &pointLocations);
+
+	/**
+	* Returns all points within the given axis-aligned box (world space).
+	*
+	* @param	box							The box in world space.
+	* @param	pointIndices				The indices of the found points.
+	* @param	pointLocations				The world locations of the found points.
+	*/
+	UFUNCTION(DisplayName = "PCR Get Points In Box", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "query box overlap select point cloud"))
+	void GetPointsInBox(FBox box, TArray<int32> &pointIndices, TArray<FVector> &pointLocations);
+
+	/**
+	* Returns the nearest points to the given location (world space), sorted by distance.
+	*
+	* @param	center						The query location in world space.
+	* @param	count						The number of points to find.
+	* @param	pointIndices				The indices of the found points.
+	* @param	pointLocations				The world locations of the found points.
+	*/
+	UFUNCTION(DisplayName = "PCR Get Nearest Points", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "query nearest knn neighbours point cloud"))
+	void GetNearestPoints(FVector center, int32 count, TArray<int32> &pointIndices, TArray<FVector> &pointLocations);
+
+	/**
+	* Saves the current point cloud (e.g. accumulated snapshots) to a compressed archive. The compression ratio and timings are logged.
+	*
+	* @param	filePath					The archive file to write.
+	* @param	precision					The quantization step of the positions (in point cloud units).
+	*/
+	UFUNCTION(DisplayName = "PCR Save Point Cloud Archive", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "save store archive compress scan snapshot point cloud"))
+	bool SavePointCloudArchive(FString filePath, float precision = 0.1f);
+
+	/**
+	* Loads a compressed point cloud archive and displays it.
+	*
+	* @param	filePath					The archive file to read.
+	*/
+	UFUNCTION(DisplayName = "PCR Load Point Cloud Archive", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "load archive compressed scan snapshot point cloud"))
+	bool LoadPointCloudArchive(FString filePath);
+
+	/**
+	* Binds this component to shared point cloud data. All components using the same name render the same points (stored and uploaded only once), each with its own transform and appearance.
+	* The data is set through any of the components via the usual input functions and is freed with its last component. Mind that input functions of one component affect all others.
+	*
+	* @param	dataName					The name of the shared data. None switches back to (empty) data owned by this component.
+	*/
+	UFUNCTION(DisplayName = "PCR Use Shared Point Cloud Data", BlueprintCallable, Category = "GPUPointCloudRenderer", meta = (Keywords = "share shared instance instancing reference scan asset point cloud"))
+	void UseSharedPointCloudData(FName dataName);
+
 private:
 	class FPointCloudStreamingCore* mPointCloudCore = nullptr;
+	TSharedPtr<class FPointCloudStreamingCore> mSharedPointCloudCore;	// Set if mPointCloudCore is shared (and not owned) by this component
+	class FPointCloudStreamReplayer* mReplayer = nullptr;
+	double mReplayTime = 0.0;
+	int32 mMeshPointCount = 0;		// The number of triangles of mBaseMesh
+	float mBoundsAge = 0.f;
 
 	UPROPERTY(VisibleAnywhere, Category = "GPUPointCloudRenderer")
 	int32 mPointCount = 0;
@@ -157,9 +438,13 @@ private:
 	bool mShouldOverrideColor = false;
 	FLinearColor mOverallColouring = FLinearColor::White;
 
-	void CreateStreamingBaseMesh(int32 pointCount = 1);
+	void CreateStreamingBaseMesh();
+	void UpdateMeshBounds();
 	void BuildTriangleStack(TArray<FCustomMeshTriangle> &triangles, const int32 &pointCount);
 	void UpdateShaderProperties();
+	FTransform GetPointCloudTransform() const;
+	void LocalToWorldPoints(TArray<FVector> &pointLocations) const;
+	void ReleasePointCloudCore();
 	//void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent);
 
 	unsigned int GetUpperPowerOfTwo(unsigned int v)
@@ -177,6 +462,7 @@ private:
 public:	
 	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	void BeginPlay() override;
+	void OnComponentDestroyed(bool bDestroyingHierarchy) override;
 	//void PostEditComponentMove(bool bFinished) override;
 
 };
\ No newline at end of file
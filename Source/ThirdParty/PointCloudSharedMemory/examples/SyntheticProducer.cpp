@@ -0,0 +1,86 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+// Synthetic capture process for testing the shared-memory point stream without a sensor.
+// Streams an animated, depth-camera-like height field.
+//
+// Build (Linux/macOS):	c++ -std=c++14 -O2 -I../include SyntheticProducer.cpp -o SyntheticProducer (add -lrt on older glibc)
+// Build (Windows):		cl /std:c++14 /O2 /EHsc /I..\include SyntheticProducer.cpp
+//
+// Usage: SyntheticProducer [segmentName] [width] [height] [fps] [frames] [global]
+// Pass "global" to create the segment in the Global namespace on Windows (requires SeCreateGlobalPrivilege).
+
+#include "PointCloudSharedMemoryProducer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+int main(int argc, char** argv)
+{
+	const char* name = argc > 1 ? argv[1] : "PointCloudStream";
+	const uint32_t width = argc > 2 ? (uint32_t)atoi(argv[2]) : 512;
+	const uint32_t height = argc > 3 ? (uint32_t)atoi(argv[3]) : 424;
+	const double fps = argc > 4 ? atof(argv[4]) : 30.0;
+	const long frameLimit = argc > 5 ? atol(argv[5]) : -1;
+	const bool globalNamespace = argc > 6 && std::string(argv[6]) == "global";
+
+	PointCloudSharedMemory::Producer producer;
+	if (!producer.Create(name, width * height, 3, globalNamespace)) {
+		fprintf(stderr, "Could not create shared memory segment '%s'.\n", name);
+		return 1;
+	}
+	printf("Streaming %ux%u points to '%s' at %.1f fps (capacity %u points per frame).\n", width, height, name, fps, producer.GetMaxPointsPerFrame());
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto frameDuration = std::chrono::duration<double>(1.0 / fps);
+	auto nextFrame = start;
+
+	for (long frame = 0; frameLimit < 0 || frame < frameLimit; ++frame) {
+
+		const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Vary the point count a bit, like a real depth sensor with invalid pixels
+		const uint32_t rows = height - (uint32_t)(height / 8 * (0.5 + 0.5 * std::sin(time)));
+		const uint32_t pointCount = width * rows;
+
+		float* positions;
+		uint8_t* colors;
+		if (producer.BeginFrame(positions, colors)) {
+
+			for (uint32_t y = 0; y < rows; ++y) {
+				for (uint32_t x = 0; x < width; ++x) {
+
+					const uint32_t i = y * width + x;
+					const float px = (float)x - width * 0.5f;
+					const float py = (float)y - height * 0.5f;
+					const float pz = 40.f * std::sin(px * 0.03f + (float)time) * std::cos(py * 0.03f + (float)time * 0.7f);
+
+					// Packed layout: R: Z, G: X, B: Y, A: Z
+					positions[i * 4 + 0] = pz;
+					positions[i * 4 + 1] = px;
+					positions[i * 4 + 2] = py;
+					positions[i * 4 + 3] = pz;
+
+					colors[i * 4 + 0] = (uint8_t)(x * 255 / width);
+					colors[i * 4 + 1] = (uint8_t)(y * 255 / height);
+					colors[i * 4 + 2] = (uint8_t)(128.f + 3.f * pz);
+					colors[i * 4 + 3] = 255;
+				}
+			}
+			producer.CommitFrame(pointCount, time);
+		}
+
+		if (frame % 100 == 0)
+			printf("Frame %ld, %u points, %llu frames dropped.\n", frame, pointCount, (unsigned long long)producer.GetDroppedFrameCount());
+
+		nextFrame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameDuration);
+		std::this_thread::sleep_until(nextFrame);
+	}
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+// Shared between the (engine-independent) producer library and the GPUPointCloudRenderer module.
+// Keep this header free of any Unreal dependencies.
+
+#include <stdint.h>
+#include <atomic>
+#include <cmath>
+
+namespace PointCloudSharedMemory
+{
+	const uint32_t Magic = 0x48535043;	// "PCSH"
+	const uint32_t Version = 1;
+	const uint32_t MaxTextureResolution = 2048;
+	const uint32_t BytesPerPosition = 16;	// float4 in the packed layout (R: Z, G: X, B: Y, A: Z)
+	const uint32_t BytesPerColor = 4;		// 4 x uint8, same byte order as the FAST input path
+	const uint64_t Alignment = 64;
+
+	/**
+	 * Header at the start of the segment.
+	 * The ring protocol: the producer may write frame n into slot (n % SlotCount) as long as n - ReadSequence < SlotCount.
+	 * After writing, it stores n + 1 into the slot's Sequence and then into WriteSequence (release).
+	 * The consumer always picks the newest frame and stores the sequence of the first frame it still needs into ReadSequence.
+	 */
+	struct SegmentHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t SlotCount;
+		uint32_t MaxPointsPerFrame;		// Padded to the renderer's texture size, so a slot can be uploaded as a whole
+		uint32_t TextureSize;			// Points per texture row/column
+		uint32_t Reserved;
+		uint64_t SlotsOffset;			// Offset of the first slot from the segment start
+		uint64_t SlotStride;			// Bytes per slot including its header
+		uint64_t PositionsOffset;		// Offset of the positions within a slot
+		uint64_t ColorsOffset;			// Offset of the colors within a slot
+		uint64_t TotalSize;
+
+		alignas(64) std::atomic<uint64_t> WriteSequence;	// Number of published frames
+		alignas(64) std::atomic<uint64_t> ReadSequence;		// First frame the consumer still holds or hasn't seen
+	};
+
+	struct alignas(64) SlotHeader
+	{
+		std::atomic<uint64_t> Sequence;	// Frame number + 1 once the slot is published
+		uint32_t PointCount;
+		uint32_t Flags;
+		double Timestamp;
+	};
+
+	// The atomics are shared between processes, so they must not carry an internal lock (the size alone does not prove that).
+	// is_always_lock_free needs C++17, older standards fall back to the equivalent macro of the 64-bit integer type
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics have to be lock-free to be shared between processes.");
+#else
+	static_assert(sizeof(long long) == sizeof(uint64_t) && ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics have to be lock-free to be shared between processes.");
+#endif
+
+	/** Texture size the renderer will use for the given point count (even, power of two). */
+	inline uint32_t GetTextureSize(uint32_t pointCount)
+	{
+		uint32_t v = (uint32_t)std::ceil(std::sqrt((double)pointCount));
+		if (v % 2 == 1) v++;
+		v--;
+		v |= v >> 1;
+		v |= v >> 2;
+		v |= v >> 4;
+		v |= v >> 8;
+		v |= v >> 16;
+		v++;
+		return v;
+	}
+
+	inline uint64_t AlignUp(uint64_t value)
+	{
+		return (value + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	/** Fills in the layout part of the header for the given capacity. */
+	inline void ComputeLayout(SegmentHeader &header, uint32_t maxPointsPerFrame, uint32_t slotCount)
+	{
+		const uint32_t textureSize = GetTextureSize(maxPointsPerFrame);
+		header.Magic = Magic;
+		header.Version = Version;
+		header.SlotCount = slotCount;
+		header.TextureSize = textureSize;
+		header.MaxPointsPerFrame = textureSize * textureSize;
+		header.Reserved = 0;
+		header.SlotsOffset = AlignUp(sizeof(SegmentHeader));
+		header.PositionsOffset = AlignUp(sizeof(SlotHeader));
+		header.ColorsOffset = AlignUp(header.PositionsOffset + (uint64_t)header.MaxPointsPerFrame * BytesPerPosition);
+		header.SlotStride = AlignUp(header.ColorsOffset + (uint64_t)header.MaxPointsPerFrame * BytesPerColor);
+		header.TotalSize = header.SlotsOffset + header.SlotStride * slotCount;
+	}
+
+	inline SlotHeader* GetSlot(SegmentHeader* header, uint64_t sequence)
+	{
+		return reinterpret_cast<SlotHeader*>(reinterpret_cast<uint8_t*>(header) + header->SlotsOffset + header->SlotStride * (sequence % header->SlotCount));
+	}
+
+	inline float* GetPositions(SegmentHeader* header, SlotHeader* slot)
+	{
+		return reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(slot) + header->PositionsOffset);
+	}
+
+	inline uint8_t* GetColors(SegmentHeader* header, SlotHeader* slot)
+	{
+		return reinterpret_cast<uint8_t*>(slot) + header->ColorsOffset;
+	}
+}
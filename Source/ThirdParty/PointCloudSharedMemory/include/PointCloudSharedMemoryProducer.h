@@ -0,0 +1,222 @@
+/*************************************************************************************************
+* Written by Valentin Kraft <valentin.kraft@online.de>, http://www.valentinkraft.de, 2018
+**************************************************************************************************/
+
+#pragma once
+
+// Header-only producer for the shared-memory point stream consumed by FPointCloudStreamingCore.
+// Does not depend on Unreal, so it can be linked into external capture processes (sensor drivers etc.).
+//
+// Usage:
+//	PointCloudSharedMemory::Producer producer;
+//	producer.Create("MySensor", 512 * 424);
+//	float* positions; uint8_t* colors;
+//	if (producer.BeginFrame(positions, colors)) {
+//		... write pointCount points in the packed layout ...
+//		producer.CommitFrame(pointCount, timestamp);
+//	}
+
+#include "PointCloudSharedMemoryLayout.h"
+
+#include <string>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace PointCloudSharedMemory
+{
+	class Producer
+	{
+	public:
+		Producer() {}
+		~Producer() { Close(); }
+		Producer(const Producer&) = delete;
+		Producer& operator=(const Producer&) = delete;
+
+		/**
+		* Creates the named segment. The name has to match the one passed to the renderer.
+		* On Windows the segment is created in the Local (session) namespace by default. The Global namespace is visible across sessions
+		* (e.g. to a capture service) but requires SeCreateGlobalPrivilege, the renderer has to connect with the same setting. Ignored on other platforms.
+		*/
+		bool Create(const char* name, uint32_t maxPointsPerFrame, uint32_t slotCount = 3, bool globalNamespace = false)
+		{
+			Close();
+			if (!name || maxPointsPerFrame == 0 || maxPointsPerFrame > MaxTextureResolution * MaxTextureResolution || slotCount < 2)
+				return false;
+
+			SegmentHeader layout;
+			ComputeLayout(layout, maxPointsPerFrame, slotCount);
+			mSize = (size_t)layout.TotalSize;
+
+#ifdef _WIN32
+			mName = std::string(globalNamespace ? "Global\\" : "Local\\") + name;
+			const uint64_t size = layout.TotalSize;
+			mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xffffffff), mName.c_str());
+			if (!mMapping)
+				return false;
+			mMemory = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, mSize);
+			if (!mMemory) {
+				Close();
+				return false;
+			}
+#else
+			mName = std::string("/") + name;
+			shm_unlink(mName.c_str());
+			const int fd = shm_open(mName.c_str(), O_CREAT | O_RDWR, 0666);
+			if (fd < 0)
+				return false;
+			mOwnsName = true;
+			if (ftruncate(fd, (off_t)mSize) != 0) {
+				close(fd);
+				Close();
+				return false;
+			}
+			void* memory = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			if (memory == MAP_FAILED) {
+				Close();
+				return false;
+			}
+			mMemory = memory;
+#endif
+
+			// Publish the layout last, so a consumer never sees a valid magic with an incomplete header
+			std::memset(mMemory, 0, (size_t)layout.SlotsOffset);
+			mHeader = new (mMemory) SegmentHeader();
+			mHeader->Magic = 0;
+			mHeader->Version = layout.Version;
+			mHeader->SlotCount = layout.SlotCount;
+			mHeader->MaxPointsPerFrame = layout.MaxPointsPerFrame;
+			mHeader->TextureSize = layout.TextureSize;
+			mHeader->Reserved = 0;
+			mHeader->SlotsOffset = layout.SlotsOffset;
+			mHeader->SlotStride = layout.SlotStride;
+			mHeader->PositionsOffset = layout.PositionsOffset;
+			mHeader->ColorsOffset = layout.ColorsOffset;
+			mHeader->TotalSize = layout.TotalSize;
+			mHeader->WriteSequence.store(0, std::memory_order_relaxed);
+			mHeader->ReadSequence.store(0, std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i < slotCount; ++i) {
+				SlotHeader* slot = new (GetSlot(mHeader, i)) SlotHeader();
+				slot->Sequence.store(0, std::memory_order_relaxed);
+				slot->PointCount = 0;
+			}
+
+			std::atomic_thread_fence(std::memory_order_release);
+			mHeader->Magic = layout.Magic;
+			return true;
+		}
+
+		void Close()
+		{
+#ifdef _WIN32
+			if (mMemory) UnmapViewOfFile(mMemory);
+			if (mMapping) CloseHandle(mMapping);
+			mMapping = NULL;
+#else
+			if (mMemory) munmap(mMemory, mSize);
+			if (mOwnsName) shm_unlink(mName.c_str());
+			mOwnsName = false;
+#endif
+			mMemory = nullptr;
+			mHeader = nullptr;
+			mCurrentSlot = nullptr;
+		}
+
+		bool IsOpen() const { return mHeader != nullptr; }
+
+		/** The capacity of a frame (padded to the renderer's texture size). */
+		uint32_t GetMaxPointsPerFrame() const { return mHeader ? mHeader->MaxPointsPerFrame : 0; }
+
+		/** Number of frames that were dropped since the consumer still held all slots. */
+		uint64_t GetDroppedFrameCount() const { return mDroppedFrames; }
+
+		/**
+		* Returns the buffers of the next free slot to write a frame into (zero-copy).
+		* Positions are float4 in the packed layout (R: Z, G: X, B: Y, A: Z), colors 4 bytes per point.
+		* Returns false if the consumer still holds all slots, the frame should be dropped then.
+		*/
+		bool BeginFrame(float* &outPositions, uint8_t* &outColors)
+		{
+			if (!mHeader)
+				return false;
+
+			const uint64_t sequence = mHeader->WriteSequence.load(std::memory_order_relaxed);
+			if (sequence - mHeader->ReadSequence.load(std::memory_order_acquire) >= mHeader->SlotCount) {
+				mDroppedFrames++;
+				return false;
+			}
+
+			mCurrentSlot = GetSlot(mHeader, sequence);
+			outPositions = GetPositions(mHeader, mCurrentSlot);
+			outColors = GetColors(mHeader, mCurrentSlot);
+			return true;
+		}
+
+		/** Publishes the frame started with BeginFrame(). */
+		void CommitFrame(uint32_t pointCount, double timestamp)
+		{
+			if (!mHeader || !mCurrentSlot)
+				return;
+
+			if (pointCount > mHeader->MaxPointsPerFrame)
+				pointCount = mHeader->MaxPointsPerFrame;
+
+			// The renderer uploads whole rows, so everything behind the frame has to be zero.
+			// Only the part the previous frame of this slot used can be dirty.
+			const uint32_t previousCount = mCurrentSlot->PointCount;
+			if (previousCount > pointCount) {
+				std::memset(GetPositions(mHeader, mCurrentSlot) + (size_t)pointCount * 4, 0, (size_t)(previousCount - pointCount) * BytesPerPosition);
+				std::memset(GetColors(mHeader, mCurrentSlot) + (size_t)pointCount * BytesPerColor, 0, (size_t)(previousCount - pointCount) * BytesPerColor);
+			}
+
+			const uint64_t sequence = mHeader->WriteSequence.load(std::memory_order_relaxed);
+			mCurrentSlot->PointCount = pointCount;
+			mCurrentSlot->Timestamp = timestamp;
+			mCurrentSlot->Sequence.store(sequence + 1, std::memory_order_release);
+			mHeader->WriteSequence.store(sequence + 1, std::memory_order_release);
+			mCurrentSlot = nullptr;
+		}
+
+		/** Copies a frame into the ring. Returns false if it had to be dropped. */
+		bool WriteFrame(const float* positions, const uint8_t* colors, uint32_t pointCount, double timestamp)
+		{
+			float* targetPositions;
+			uint8_t* targetColors;
+			if (!BeginFrame(targetPositions, targetColors))
+				return false;
+
+			if (pointCount > mHeader->MaxPointsPerFrame)
+				pointCount = mHeader->MaxPointsPerFrame;
+			std::memcpy(targetPositions, positions, (size_t)pointCount * BytesPerPosition);
+			std::memcpy(targetColors, colors, (size_t)pointCount * BytesPerColor);
+			CommitFrame(pointCount, timestamp);
+			return true;
+		}
+
+	private:
+		std::string mName;
+		void* mMemory = nullptr;
+		size_t mSize = 0;
+		SegmentHeader* mHeader = nullptr;
+		SlotHeader* mCurrentSlot = nullptr;
+		uint64_t mDroppedFrames = 0;
+#ifdef _WIN32
+		HANDLE mMapping = NULL;
+#else
+		bool mOwnsName = false;
+#endif
+	};
+}